@@ -10,6 +10,7 @@
 
 #include <climits>
 #include <string>
+#include <vector>
 
 #if defined(_WIN32)
 // Tell Windows not to define min() and max() macros
@@ -68,6 +69,21 @@ enum class ComputeNormalsOption {
   ALWAYS // compute a new normal for every vertex, obliterating whatever may have been there before
 };
 
+/**
+ * When to generate MikkTSpace tangents for vertices of normal-mapped materials.
+ */
+enum class ComputeTangentsOption {
+  NEVER, // only ever export tangents read from the FBX
+  MISSING, // generate tangents for normal-mapped vertices that came without one
+  ALWAYS // generate a new tangent for every normal-mapped vertex
+};
+
+/**
+ * The EXT_meshopt_compression filters, which transform a stream before compression so it packs
+ * better: OCTAHEDRAL for unit vectors, QUATERNION for rotations, EXPONENTIAL for other floats.
+ */
+enum class MeshoptFilter { NONE, OCTAHEDRAL, QUATERNION, EXPONENTIAL };
+
 enum class UseLongIndicesOptions {
   NEVER, // only ever use 16-bit indices
   AUTO, // use shorts or longs depending on vertex count
@@ -80,6 +96,52 @@ enum class AnimationFramerateOptions {
   BAKE60, // bake animations at 60 fps
 };
 
+/**
+ * An affine transform of texture coordinates, stored as the top two rows of a 3x3 matrix:
+ * u' = m[0][0] * u + m[0][1] * v + m[0][2], and likewise for v' with m[1]. Composing any number of
+ * flips, scales and offsets still costs one multiply-add per coordinate.
+ */
+struct UVTransform {
+  float m[2][3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+
+  static UVTransform Scale(const float scaleU, const float scaleV) {
+    return {{{scaleU, 0.0f, 0.0f}, {0.0f, scaleV, 0.0f}}};
+  }
+  static UVTransform Offset(const float offsetU, const float offsetV) {
+    return {{{1.0f, 0.0f, offsetU}, {0.0f, 1.0f, offsetV}}};
+  }
+  // u -> 1 - u
+  static UVTransform FlipU() {
+    return {{{-1.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}}};
+  }
+  // v -> 1 - v
+  static UVTransform FlipV() {
+    return {{{1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 1.0f}}};
+  }
+
+  // The transform that applies this one, then next.
+  UVTransform Then(const UVTransform& next) const {
+    UVTransform result;
+    for (int row = 0; row < 2; row++) {
+      for (int col = 0; col < 3; col++) {
+        result.m[row][col] = next.m[row][0] * m[0][col] + next.m[row][1] * m[1][col];
+      }
+      result.m[row][2] += next.m[row][2];
+    }
+    return result;
+  }
+
+  bool IsIdentity() const {
+    return m[0][0] == 1.0f && m[0][1] == 0.0f && m[0][2] == 0.0f && m[1][0] == 0.0f &&
+        m[1][1] == 1.0f && m[1][2] == 0.0f;
+  }
+
+  Vec2f Apply(const Vec2f& uv) const {
+    return Vec2f(
+        m[0][0] * uv[0] + m[0][1] * uv[1] + m[0][2], m[1][0] * uv[0] + m[1][1] * uv[1] + m[1][2]);
+  }
+};
+
 /**
  * User-supplied options that dictate the nature of the glTF being generated.
  */
@@ -107,6 +169,35 @@ struct GltfOptions {
     int quantBitsGeneric = 8;
   } draco;
 
+  /**
+   * Whether and how to use EXT_meshopt_compression on the bufferViews of vertex attributes,
+   * indices, morph targets and animations. Compared to Draco, it decodes much faster and covers
+   * animation data too; it can be combined with Draco, which then keeps handling geometry.
+   */
+  struct {
+    bool enabled = false;
+    MeshoptFilter normalFilter = MeshoptFilter::NONE; // NONE or OCTAHEDRAL
+    MeshoptFilter rotationFilter = MeshoptFilter::NONE; // NONE or QUATERNION
+    MeshoptFilter deltaFilter = MeshoptFilter::NONE; // NONE or EXPONENTIAL
+    int bitsForNormals = 12;
+    int bitsForRotations = 12;
+    int bitsForDeltas = 15;
+  } meshopt;
+
+  /**
+   * Whether and how to use KHR_mesh_quantization to store vertex attributes as integers: positions
+   * as shorts dequantized by a node (or, for skinned meshes, the inverse bind matrices), normals
+   * and tangents as normalized bytes, and texture coordinates as normalized shorts, remapped with
+   * KHR_texture_transform when they fall outside [0, 1]. Morph target deltas follow suit, position
+   * deltas on the grid of the positions. Ignored for Draco-compressed geometry.
+   */
+  struct {
+    bool enabled = false;
+    int quantBitsPosition = 14;
+    int quantBitsTexCoord = 12;
+    int quantBitsNormal = 8;
+  } quantize;
+
   /** Whether to include FBX User Properties as 'extras' metadata in glTF nodes. */
   bool enableUserProperties{false};
 
@@ -124,10 +215,61 @@ struct GltfOptions {
   bool useBlendShapeTangents{false};
   /** When to compute vertex normals from geometry. */
   ComputeNormalsOption computeNormals = ComputeNormalsOption::BROKEN;
+  /** When to generate tangents for normal-mapped materials. */
+  ComputeTangentsOption computeTangents = ComputeTangentsOption::MISSING;
+  /** Whether to reorder triangles for the GPU's post-transform vertex cache. */
+  bool optimizeVertexCache{false};
+  /**
+   * If nonzero, also reorder the triangles of opaque primitives to reduce overdraw, letting the
+   * vertex cache miss ratio degrade by at most this factor (e.g. 1.05).
+   */
+  float optimizeOverdraw{0.0f};
+  /** Whether to split primitives into meshlets and describe them, with culling data, in extras. */
+  bool buildMeshlets{false};
+  /**
+   * Whether to bake the meshes of unanimated nodes into one mesh, with a primitive per material,
+   * rather than write a mesh per node.
+   */
+  bool mergeStatic{false};
+  /** Whether to fold sibling nodes sharing a static mesh into one EXT_mesh_gpu_instancing node. */
+  bool gpuInstancing{false};
+  /**
+   * Lower levels of detail to simplify each mesh to, offered as MSFT_lod alternatives: the target
+   * fraction of the triangles for each level, and the largest deviation, relative to the mesh
+   * extent, allowed for each level; the last error applies to any further levels.
+   */
+  struct {
+    std::vector<float> ratios;
+    std::vector<float> errors{0.01f};
+  } lod;
   /** When to use 32-bit indices. */
   UseLongIndicesOptions useLongIndices = UseLongIndicesOptions::AUTO;
   /** Select baked animation framerate. */
   AnimationFramerateOptions animationFramerate = AnimationFramerateOptions::BAKE24;
+  /**
+   * Whether to export the keys of FBX animation curves as they are, where the node's transform is
+   * plain translation, rotation and scale and glTF interpolation reproduces the curves exactly,
+   * rather than bake every animated node at the framerate.
+   */
+  bool animationNativeKeys{false};
+  /**
+   * Whether to bake animation stacks in parallel, each worker thread from a scene of its own that
+   * it imports anew from the file.
+   */
+  bool parallelAnimations{false};
+  /**
+   * Whether to drop the baked animation keys that interpolating between the remaining ones
+   * reproduces closely enough: within translationError metres, rotationError degrees, and
+   * scaleError for scales and morph target weights.
+   */
+  struct {
+    bool enabled = false;
+    float translationError = 0.0001f;
+    float rotationError = 0.01f;
+    float scaleError = 0.0001f;
+  } keyReduction;
+  /** Transform applied to every texture coordinate by LoadFBXFile, e.g. to flip U and/or V. */
+  UVTransform uvTransform;
 
   /** Temporary directory used by FBX SDK. */
   std::string fbxTempDir;
@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "FBX2glTF.h"
+
+/**
+ * Evaluates the transforms of some nodes, and of their ancestors, at one time after another. Each
+ * time, it walks the nodes parents first and evaluates every global transform once, so the SDK can
+ * reuse each parent's transform already worked out for that time, and it derives local transforms
+ * from the parent's cached global transform rather than evaluating the chain of ancestors again.
+ * Anything else that wants the pose at that time, e.g. the joints of a skin, can read the cached
+ * global transforms too.
+ */
+class FbxTransformCache {
+ public:
+  explicit FbxTransformCache(const std::vector<FbxNode*>& nodes);
+
+  // Evaluates the global transform of every node at the given time.
+  void Evaluate(const FbxTime& time);
+
+  // The global transform of a node (or of one of its ancestors) at the last evaluated time.
+  const FbxAMatrix& GetGlobalTransform(const FbxNode* pNode) const {
+    return globalTransforms[nodeIndices.at(pNode)];
+  }
+
+  // The local transform of a node (or of one of its ancestors) at the last evaluated time.
+  FbxAMatrix GetLocalTransform(const FbxNode* pNode) const;
+
+ private:
+  int AddNode(FbxNode* pNode);
+
+  std::vector<FbxNode*> nodes; // parents before children
+  std::vector<int> parentIndices; // -1 for the root
+  std::unordered_map<const FbxNode*, int> nodeIndices;
+
+  std::vector<FbxAMatrix> globalTransforms;
+  std::vector<FbxAMatrix> inverseGlobalTransforms; // only for parents
+  std::vector<bool> isParent;
+};
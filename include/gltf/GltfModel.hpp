@@ -55,6 +55,7 @@ class GltfModel {
   explicit GltfModel(const GltfOptions& options)
       : binary(new std::vector<uint8_t>),
         isGlb(options.outputBinary),
+        meshopt(options.meshopt),
         defaultSampler(nullptr),
         defaultBuffer(buffers.hold(buildDefaultBuffer(options))) {
     defaultSampler = samplers.hold(buildDefaultSampler());
@@ -69,23 +70,98 @@ class GltfModel {
       BufferData& buffer,
       const std::string& filename);
 
+  // With EXT_meshopt_compression enabled, the view is stored compressed, and the filter, if any,
+  // is applied to the (float) data first; this may turn it into normalized shorts. The view must
+  // be the last one that was created.
   template <class T>
   std::shared_ptr<AccessorData> AddAccessorWithView(
       BufferViewData& bufferView,
       const GLType& type,
       const std::vector<T>& source,
-      std::string name) {
+      std::string name,
+      const MeshoptFilter filter = MeshoptFilter::NONE) {
+    if (meshopt.enabled && filter != MeshoptFilter::NONE) {
+      // the filters take four floats per element for unit vectors and rotations
+      const unsigned int components =
+          (filter == MeshoptFilter::EXPONENTIAL) ? type.count : std::max(type.count, (uint8_t)4);
+      std::vector<float> floats(source.size() * components, 0.0f);
+      for (size_t ii = 0; ii < source.size(); ii++) {
+        type.write((uint8_t*)&floats[ii * components], source[ii]);
+      }
+      return AddFilteredAccessorWithView(bufferView, type, floats, name, filter);
+    }
     auto accessor = accessors.hold(new AccessorData(bufferView, type, name));
     accessor->appendAsBinaryArray(source, *binary);
     bufferView.byteLength = accessor->byteLength();
+    if (meshopt.enabled) {
+      CompressBufferView(bufferView, accessor->count, type.byteStride(), MeshoptFilter::NONE);
+    }
+    return accessor;
+  }
+
+  // Stores elements the caller has already encoded as the component type, each padded to
+  // byteStride bytes, e.g. quantized vertex attributes that keep their four-byte alignment.
+  std::shared_ptr<AccessorData> AddEncodedAccessorWithView(
+      BufferViewData& bufferView,
+      const GLType& type,
+      const std::vector<uint8_t>& source,
+      const uint32_t byteStride,
+      const bool normalized,
+      const std::string& name);
+
+  // Adds an accessor of count elements that are all zero but at the given (ascending) indices,
+  // where they take the given values; a sparse accessor, with no bufferView of its own. Sparse
+  // values must be tightly packed, so of the filters only EXPONENTIAL applies.
+  template <class T>
+  std::shared_ptr<AccessorData> AddSparseAccessor(
+      BufferData& buffer,
+      const GLType& type,
+      const uint32_t count,
+      const std::vector<uint32_t>& indices,
+      const std::vector<T>& values,
+      const std::string& name,
+      const MeshoptFilter filter = MeshoptFilter::NONE) {
+    auto accessor = accessors.hold(new AccessorData(type));
+    accessor->count = count;
+    accessor->name = name;
+    if (indices.empty()) {
+      return accessor;
+    }
+
+    AddSparseIndices(buffer, *accessor, indices);
+    auto valueView = GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_NONE);
+    if (meshopt.enabled && filter == MeshoptFilter::EXPONENTIAL) {
+      std::vector<float> floats(values.size() * type.count);
+      for (size_t ii = 0; ii < values.size(); ii++) {
+        type.write((uint8_t*)&floats[ii * type.count], values[ii]);
+      }
+      AppendFiltered(*valueView, type, floats, filter);
+    } else {
+      AppendElements(*valueView, type, values);
+    }
+    accessor->sparseValuesBufferView = valueView->ix;
     return accessor;
   }
 
+  // As AddSparseAccessor(), for values the caller has already encoded as the component type,
+  // tightly packed.
+  std::shared_ptr<AccessorData> AddEncodedSparseAccessor(
+      BufferData& buffer,
+      const GLType& type,
+      const uint32_t count,
+      const std::vector<uint32_t>& indices,
+      const std::vector<uint8_t>& values,
+      const bool normalized,
+      const std::string& name);
+
   template <class T>
-  std::shared_ptr<AccessorData>
-  AddAccessorAndView(BufferData& buffer, const GLType& type, const std::vector<T>& source) {
+  std::shared_ptr<AccessorData> AddAccessorAndView(
+      BufferData& buffer,
+      const GLType& type,
+      const std::vector<T>& source,
+      const MeshoptFilter filter = MeshoptFilter::NONE) {
     auto bufferView = GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_NONE);
-    return AddAccessorWithView(*bufferView, type, source, std::string(""));
+    return AddAccessorWithView(*bufferView, type, source, std::string(""), filter);
   }
 
   template <class T>
@@ -93,20 +169,23 @@ class GltfModel {
       BufferData& buffer,
       const GLType& type,
       const std::vector<T>& source,
-      std::string name) {
+      std::string name,
+      const MeshoptFilter filter = MeshoptFilter::NONE) {
     auto bufferView = GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_NONE);
-    return AddAccessorWithView(*bufferView, type, source, name);
+    return AddAccessorWithView(*bufferView, type, source, name, filter);
   }
 
   template <class T>
   std::shared_ptr<AccessorData> AddAttributeToPrimitive(
       BufferData& buffer,
-      const RawModel& surfaceModel,
+      const RawModel& raw,
+      const RawPrimitive& rawPrimitive,
       PrimitiveData& primitive,
-      const AttributeDefinition<T>& attrDef) {
-    // copy attribute data into vector
+      const AttributeDefinition<T>& attrDef,
+      const MeshoptFilter filter = MeshoptFilter::NONE) {
+    // gather the primitive's slice of the attribute
     std::vector<T> attribArr;
-    surfaceModel.GetAttributeArray<T>(attribArr, attrDef.rawAttributeIx);
+    raw.GetAttributeArray<T>(attribArr, attrDef.rawAttributeIx, rawPrimitive);
 
     std::shared_ptr<AccessorData> accessor;
     if (attrDef.dracoComponentType != draco::DT_INVALID && primitive.dracoMesh != nullptr) {
@@ -116,7 +195,8 @@ class GltfModel {
       accessor->count = to_uint32(attribArr.size());
     } else {
       auto bufferView = GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER);
-      accessor = AddAccessorWithView(*bufferView, attrDef.glType, attribArr, std::string(""));
+      accessor =
+          AddAccessorWithView(*bufferView, attrDef.glType, attribArr, std::string(""), filter);
     }
     primitive.AddAttrib(attrDef.gltfName, *accessor);
     return accessor;
@@ -136,6 +216,7 @@ class GltfModel {
   void serializeHolders(json& glTFJson);
 
   const bool isGlb;
+  const decltype(GltfOptions::meshopt) meshopt;
 
   // cache BufferViewData instances that've already been created from a given filename
   std::map<std::string, std::shared_ptr<BufferViewData>> filenameToBufferView;
@@ -161,6 +242,45 @@ class GltfModel {
   std::shared_ptr<BufferData> defaultBuffer;
 
  private:
+  std::shared_ptr<AccessorData> AddFilteredAccessorWithView(
+      BufferViewData& bufferView,
+      const GLType& type,
+      const std::vector<float>& source,
+      const std::string& name,
+      const MeshoptFilter filter);
+  // Writes the indices of a sparse accessor to a new view and points the accessor at them.
+  void AddSparseIndices(
+      BufferData& buffer,
+      AccessorData& accessor,
+      const std::vector<uint32_t>& indices);
+  // Writes the floats, as encoded by the filter, to the view; returns the element count.
+  uint32_t AppendFiltered(
+      BufferViewData& bufferView,
+      const GLType& type,
+      const std::vector<float>& source,
+      const MeshoptFilter filter);
+  template <class T>
+  void
+  AppendElements(BufferViewData& bufferView, const GLType& type, const std::vector<T>& source) {
+    const size_t offset = binary->size();
+    binary->resize(offset + source.size() * type.byteStride());
+    for (size_t ii = 0; ii < source.size(); ii++) {
+      type.write(&(*binary)[offset + ii * type.byteStride()], source[ii]);
+    }
+    bufferView.byteLength = to_uint32(source.size() * type.byteStride());
+    if (meshopt.enabled) {
+      CompressBufferView(
+          bufferView, to_uint32(source.size()), type.byteStride(), MeshoptFilter::NONE);
+    }
+  }
+  void CompressBufferView(
+      BufferViewData& bufferView,
+      const uint32_t count,
+      const uint32_t byteStride,
+      const MeshoptFilter filter);
+
+  std::shared_ptr<BufferData> meshoptFallbackBuffer;
+
   SamplerData* buildDefaultSampler() {
     return new SamplerData();
   }
@@ -22,6 +22,11 @@
 const std::string KHR_DRACO_MESH_COMPRESSION = "KHR_draco_mesh_compression";
 const std::string KHR_MATERIALS_CMN_UNLIT = "KHR_materials_unlit";
 const std::string KHR_LIGHTS_PUNCTUAL = "KHR_lights_punctual";
+const std::string EXT_MESHOPT_COMPRESSION = "EXT_meshopt_compression";
+const std::string KHR_MESH_QUANTIZATION = "KHR_mesh_quantization";
+const std::string KHR_TEXTURE_TRANSFORM = "KHR_texture_transform";
+const std::string MSFT_LOD = "MSFT_lod";
+const std::string EXT_MESH_GPU_INSTANCING = "EXT_mesh_gpu_instancing";
 
 const std::string extBufferFilename = "buffer.bin";
 
@@ -41,6 +46,8 @@ struct ComponentType {
   const unsigned int size;
 };
 
+const ComponentType CT_BYTE = {ComponentType::GL_BYTE, 1};
+const ComponentType CT_SHORT = {ComponentType::GL_SHORT, 2};
 const ComponentType CT_USHORT = {ComponentType::GL_UNSIGNED_SHORT, 2};
 const ComponentType CT_UINT = {ComponentType::GL_UNSIGNED_INT, 4};
 const ComponentType CT_FLOAT = {ComponentType::GL_FLOAT, 4};
@@ -203,14 +210,14 @@ struct Holdable {
 template <class T>
 struct AttributeDefinition {
   const std::string gltfName;
-  const T RawVertex::*rawAttributeIx;
+  const std::vector<T> RawVertexStreams::*rawAttributeIx;
   const GLType glType;
   const draco::GeometryAttribute::Type dracoAttribute;
   const draco::DataType dracoComponentType;
 
   AttributeDefinition(
       const std::string gltfName,
-      const T RawVertex::*rawAttributeIx,
+      const std::vector<T> RawVertexStreams::*rawAttributeIx,
       const GLType& _glType,
       const draco::GeometryAttribute::Type dracoAttribute,
       const draco::DataType dracoComponentType)
@@ -222,7 +229,7 @@ struct AttributeDefinition {
 
   AttributeDefinition(
       const std::string gltfName,
-      const T RawVertex::*rawAttributeIx,
+      const std::vector<T> RawVertexStreams::*rawAttributeIx,
       const GLType& _glType)
       : gltfName(gltfName),
         rawAttributeIx(rawAttributeIx),
@@ -42,7 +42,14 @@ struct AccessorData : Holdable {
 
   unsigned int byteOffset;
   unsigned int count;
+  bool normalized = false;
   std::vector<float> min;
   std::vector<float> max;
   std::string name;
+
+  // if sparseCount is nonzero, the elements at these indices are replaced by these values
+  unsigned int sparseCount = 0;
+  int sparseIndicesBufferView = -1;
+  unsigned int sparseIndicesComponentType = 0;
+  int sparseValuesBufferView = -1;
 };
@@ -15,6 +15,9 @@
 #include "gltf/Raw2Gltf.hpp"
 
 struct BufferData : Holdable {
+  // The data-less fallback buffer for the views stored with EXT_meshopt_compression.
+  BufferData();
+
   explicit BufferData(const std::shared_ptr<const std::vector<uint8_t>>& binData);
 
   BufferData(
@@ -27,4 +30,7 @@ struct BufferData : Holdable {
   const bool isGlb;
   const std::string uri;
   const std::shared_ptr<const std::vector<uint8_t>> binData; // TODO this is just weird
+
+  const bool isMeshoptFallback;
+  unsigned int fallbackByteLength = 0;
 };
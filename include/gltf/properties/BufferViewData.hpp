@@ -26,4 +26,15 @@ struct BufferViewData : Holdable {
   const GL_ArrayType target;
 
   unsigned int byteLength = 0;
+  unsigned int byteStride = 0; // only set when elements don't follow each other tightly
+
+  // Set when the view is stored with EXT_meshopt_compression: the compressed bytes then sit at
+  // buffer/byteOffset, while the view itself points into a fallback buffer that has no data.
+  int fallbackBuffer = -1;
+  unsigned int fallbackByteOffset = 0;
+  unsigned int compressedByteLength = 0;
+  unsigned int compressedByteStride = 0;
+  unsigned int compressedCount = 0;
+  std::string compressionMode;
+  std::string compressionFilter;
 };
@@ -66,6 +66,11 @@ struct MaterialData : Holdable {
   const std::shared_ptr<const KHRCmnUnlitMaterial> khrCmnConstantMaterial;
   const std::shared_ptr<const PBRMetallicRoughness> pbrMetallicRoughness;
 
+  // KHR_texture_transform for every texture, mapping quantized texture coordinates back
+  bool hasTexCoordTransform = false;
+  Vec2f texCoordOffset{0.0f, 0.0f};
+  Vec2f texCoordScale{1.0f, 1.0f};
+
   std::vector<std::string> userProperties;
 };
 
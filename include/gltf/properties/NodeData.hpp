@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -40,5 +41,10 @@ struct NodeData : Holdable {
   int32_t light;
   int32_t skin;
   std::vector<std::string> skeletons;
+  // MSFT_lod: the nodes of the lower levels of detail, and the screen coverage of every level
+  std::vector<uint32_t> lods;
+  std::vector<float> lodScreenCoverages;
+  // EXT_mesh_gpu_instancing: the TRANSLATION, ROTATION and SCALE accessors of the instances
+  std::map<std::string, uint32_t> instanceAttributes;
   std::vector<std::string> userProperties;
 };
@@ -67,6 +67,14 @@ struct PrimitiveData {
 
   void NoteDracoBuffer(const BufferViewData& data);
 
+  // Describe the meshlets of the primitive in its extras; see BuildMeshlets().
+  void AddMeshlets(
+      const int maxVertices,
+      const int maxTriangles,
+      const AccessorData& triangleOffsets,
+      const AccessorData& bounds,
+      const AccessorData& cones);
+
   const int indices;
   const unsigned int material;
   const MeshMode mode;
@@ -79,6 +87,8 @@ struct PrimitiveData {
 
   std::shared_ptr<draco::Mesh> dracoMesh;
   int dracoBufferView;
+
+  json meshlets;
 };
 
 void to_json(json& j, const PrimitiveData& d);
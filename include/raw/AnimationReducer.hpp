@@ -0,0 +1,20 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "raw/RawModel.hpp"
+
+// Drop the keys of each property of the channel that interpolating between the remaining ones
+// reproduces within the tolerances, and give the property the times of the keys it keeps. Each
+// property is interpolated LINEAR, or STEP where holding its keys needs fewer of them. The channel
+// must hold a key at every one of the times for each property it animates.
+void ReduceChannelKeys(
+    RawChannel& channel,
+    const std::vector<float>& times,
+    const decltype(GltfOptions::keyReduction)& tolerances);
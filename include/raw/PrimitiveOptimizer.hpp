@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "raw/RawModel.hpp"
+
+// The bounds of the meshlets built by BuildMeshlets().
+const int MESHLET_MAX_VERTICES = 64;
+const int MESHLET_MAX_TRIANGLES = 124;
+
+// Transformed vertices are assumed to be cached in a FIFO of this many entries when measuring.
+const int VERTEX_CACHE_FIFO_SIZE = 16;
+
+// The number of vertex transforms a draw of the primitive costs with a FIFO post-transform cache;
+// divided by the triangle count this is the ACMR (average cache miss ratio).
+size_t CountVertexCacheMisses(const RawPrimitive& primitive);
+
+// Reorder the triangles of the primitive for post-transform vertex cache locality, following Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation". Only the order of the indices changes.
+void OptimizeVertexCache(RawPrimitive& primitive);
+
+// Reorder the triangles of a cache-optimized primitive to reduce overdraw, after Sander et al.,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw". The triangles are cut into
+// clusters whose ACMR stays within threshold (e.g. 1.05) times that of the input, and the clusters
+// are drawn in an approximate front-to-back order. Positions are indexed by model vertex.
+void OptimizeOverdraw(
+    RawPrimitive& primitive,
+    const std::vector<Vec3f>& positions,
+    const float threshold);
+
+// Renumber the vertices of the primitive in the order the indices first use them, so that vertex
+// fetch walks the attribute arrays nearly sequentially. As every attribute, blend target and Draco
+// input is gathered through primitive.vertices, permuting it remaps all of them at once.
+void OptimizeVertexFetch(RawPrimitive& primitive);
+
+// Split the triangles of the primitive, in their current order, into consecutive runs that use at
+// most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles, and compute the bounding
+// sphere and normal cone of each. Works best on a cache-optimized primitive. Positions are indexed
+// by model vertex.
+void BuildMeshlets(RawPrimitive& primitive, const std::vector<Vec3f>& positions);
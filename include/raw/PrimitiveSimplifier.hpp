@@ -0,0 +1,24 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "raw/RawModel.hpp"
+
+// Build a lower level of detail of the primitive by quadric edge collapse, aiming at targetRatio
+// of its triangles but stopping before the deviation exceeds targetError, relative to the extent
+// of the primitive. The primitive's border, which is where it meets other materials, stays put;
+// so do UV and normal seams, which split vertices, and the vertices where the dominant joint of a
+// skinned primitive changes. The result is another view of the same model vertices, so it keeps
+// every attribute, skin weight and blend shape; it may have no triangles left. The primitive must
+// have positions.
+RawPrimitive SimplifyPrimitive(
+    const RawModel& raw,
+    const RawPrimitive& primitive,
+    const float targetRatio,
+    const float targetError);
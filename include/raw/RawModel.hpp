@@ -27,10 +27,22 @@ enum RawVertexAttribute {
   RAW_VERTEX_ATTRIBUTE_AUTO = 1 << 31
 };
 
+// Mix the hash of a value into a running hash, as boost::hash_combine does.
+template <typename T>
+inline size_t HashCombine(const size_t seed, const T& value) {
+  return seed ^ (std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+inline size_t HashCombine(const size_t seed, const Vec3f& value) {
+  return HashCombine(HashCombine(HashCombine(seed, value.x), value.y), value.z);
+}
+inline size_t HashCombine(const size_t seed, const Vec4f& value) {
+  return HashCombine(HashCombine(seed, Vec3f(value)), value.w);
+}
+
 struct RawBlendVertex {
   Vec3f position{0.0f};
   Vec3f normal{0.0f};
-  Vec4f tangent{0.0f};
+  Vec3f tangent{0.0f}; // morph targets displace only the xyz of tangents
 
   bool operator==(const RawBlendVertex& other) const {
     return position == other.position && normal == other.normal && tangent == other.tangent;
@@ -50,11 +62,8 @@ struct RawVertex {
   // end of members that directly correspond to vertex attributes
 
   // if this vertex participates in a blend shape setup, the surfaceIx of its dedicated mesh;
-  // otherwise, -1
+  // otherwise, -1. The blend deltas themselves are passed to and stored by the RawModel.
   int blendSurfaceIx = -1;
-  // the size of this vector is always identical to the size of the corresponding
-  // RawSurface.blendChannels
-  std::vector<RawBlendVertex> blends;
 
   bool polarityUv0 = false;
   bool pad1 = false;
@@ -65,11 +74,111 @@ struct RawVertex {
   size_t Difference(const RawVertex& other) const;
 };
 
-class VertexHasher {
+/**
+ * The vertices of a RawModel, stored as one contiguous array per attribute. The array of an
+ * attribute that the model doesn't carry stays empty, so e.g. a mesh without tangents or a second
+ * UV set pays nothing for them, and exporters can hand each array straight to an accessor.
+ */
+struct RawVertexStreams {
+  std::vector<Vec3f> position;
+  std::vector<Vec3f> normal;
+  std::vector<Vec3f> binormal;
+  std::vector<Vec4f> tangent;
+  std::vector<Vec4f> color;
+  std::vector<Vec2f> uv0;
+  std::vector<Vec2f> uv1;
+  std::vector<Vec4i> jointIndices;
+  std::vector<Vec4f> jointWeights;
+  // end of arrays that directly correspond to vertex attributes
+
+  // always populated; its size is the vertex count
+  std::vector<uint8_t> polarityUv0;
+  // the blend surface of each vertex and its row in that surface's blend deltas, or -1 for both;
+  // these stay empty until the first vertex of a blend shape surface is added
+  std::vector<int> blendSurfaceIx;
+  std::vector<int> blendRow;
+
+  size_t Count() const {
+    return polarityUv0.size();
+  }
+  // Make sure the arrays of the given attributes cover every vertex, padding with defaults.
+  void Allocate(const int attributes);
+  void Append(const RawVertex& vertex, const int attributes);
+  RawVertex Get(const int index, const int attributes) const;
+};
+
+// The morph target deltas of one blend channel of a surface, one entry per blend row.
+struct RawBlendDeltas {
+  std::vector<Vec3f> positions;
+  std::vector<Vec3f> normals; // empty unless the channel has normals
+  std::vector<Vec3f> tangents; // empty unless the channel has tangents
+};
+
+/**
+ * Open-addressing hash table used to deduplicate vertices as they are added to a RawModel.
+ *
+ * Each slot holds only a 32-bit hash and a vertex index; the vertex data itself stays in the
+ * owning model, and the caller supplies the equality test for a candidate index. Only the
+ * attributes named in the table's attribute mask contribute to the hash, so vertices that
+ * differ solely in attributes the model doesn't carry never cost a hash of those bytes.
+ */
+class VertexTable {
  public:
-  size_t operator()(const RawVertex& v) const;
+  // Hash the attributes of a vertex selected by a RawVertexAttribute bitfield, plus the members
+  // that always distinguish vertices (blend surface and UV polarity).
+  static uint32_t Hash(const RawVertex& vertex, const int attributes);
+
+  // Empty the table and set the attribute mask used to hash subsequent insertions.
+  void Clear(const int attributes);
+  void Reserve(const size_t count);
+
+  int GetAttributes() const {
+    return attributes;
+  }
+  size_t GetCount() const {
+    return count;
+  }
+
+  // Return the index of a stored vertex for which equal(index) holds, or else store and return
+  // newIndex.
+  template <typename _equal_>
+  int FindOrInsert(const uint32_t hash, const int newIndex, const _equal_& equal);
+  // Store an index that is known not to be present yet.
+  void Insert(const uint32_t hash, const int index);
+
+ private:
+  struct Slot {
+    uint32_t hash;
+    int index;
+  };
+
+  void Grow();
+
+  std::vector<Slot> slots;
+  size_t count = 0;
+  int attributes = 0;
 };
 
+template <typename _equal_>
+int VertexTable::FindOrInsert(const uint32_t hash, const int newIndex, const _equal_& equal) {
+  if ((count + 1) * 4 > slots.size() * 3) {
+    Grow();
+  }
+  const size_t mask = slots.size() - 1;
+  for (size_t slotIx = hash & mask;; slotIx = (slotIx + 1) & mask) {
+    Slot& slot = slots[slotIx];
+    if (slot.index < 0) {
+      slot.hash = hash;
+      slot.index = newIndex;
+      count++;
+      return newIndex;
+    }
+    if (slot.hash == hash && equal(slot.index)) {
+      return slot.index;
+    }
+  }
+}
+
 struct RawTriangle {
   int verts[3];
   int materialIndex;
@@ -182,6 +291,10 @@ struct RawMatProps {
   virtual bool operator==(const RawMatProps& other) const {
     return shadingModel == other.shadingModel;
   };
+  // Props that compare equal must hash alike.
+  virtual size_t Hash() const {
+    return HashCombine(0, (int)shadingModel);
+  }
 };
 
 struct RawTraditionalMatProps : RawMatProps {
@@ -214,6 +327,14 @@ struct RawTraditionalMatProps : RawMatProps {
     }
     return false;
   }
+  size_t Hash() const override {
+    size_t seed = RawMatProps::Hash();
+    seed = HashCombine(seed, ambientFactor);
+    seed = HashCombine(seed, diffuseFactor);
+    seed = HashCombine(seed, specularFactor);
+    seed = HashCombine(seed, emissiveFactor);
+    return HashCombine(seed, shininess);
+  }
 };
 
 struct RawMetRoughMatProps : RawMatProps {
@@ -248,6 +369,14 @@ struct RawMetRoughMatProps : RawMatProps {
     }
     return false;
   }
+  size_t Hash() const override {
+    size_t seed = RawMatProps::Hash();
+    seed = HashCombine(seed, diffuseFactor);
+    seed = HashCombine(seed, emissiveFactor);
+    seed = HashCombine(seed, emissiveIntensity);
+    seed = HashCombine(seed, metallic);
+    return HashCombine(seed, roughness);
+  }
 };
 
 struct RawMaterial {
@@ -294,12 +423,29 @@ struct RawSurface {
   bool discrete;
 };
 
+enum RawInterpolation {
+  RAW_INTERPOLATION_LINEAR,
+  RAW_INTERPOLATION_STEP,
+  // each key holds an in-tangent, the value and an out-tangent, in that order
+  RAW_INTERPOLATION_CUBICSPLINE
+};
+
+// When the keys of an animated property fall, and how to interpolate between them.
+struct RawKeyTiming {
+  std::vector<float> times; // if empty, the keys fall at the times of the animation
+  RawInterpolation interpolation = RAW_INTERPOLATION_LINEAR;
+};
+
 struct RawChannel {
   int nodeIndex;
   std::vector<Vec3f> translations;
   std::vector<Quatf> rotations;
   std::vector<Vec3f> scales;
-  std::vector<float> weights;
+  std::vector<float> weights; // the weights of all morph targets of the node, key by key
+  RawKeyTiming translationTiming;
+  RawKeyTiming rotationTiming;
+  RawKeyTiming scaleTiming;
+  RawKeyTiming weightTiming;
 };
 
 struct RawAnimation {
@@ -330,6 +476,13 @@ struct RawCamera {
   } orthographic;
 };
 
+// The local transform of one copy of a node's mesh, drawn through EXT_mesh_gpu_instancing.
+struct RawInstance {
+  Vec3f translation;
+  Quatf rotation;
+  Vec3f scale;
+};
+
 struct RawNode {
   bool isJoint;
   long id;
@@ -342,6 +495,41 @@ struct RawNode {
   long surfaceId;
   long lightIx;
   std::vector<std::string> userProperties;
+  std::vector<RawInstance> instances; // if non-empty, the mesh is drawn once per instance
+};
+
+// A cluster of a primitive's triangles, with the data to cull it as a whole.
+struct RawMeshlet {
+  uint32_t firstTriangle = 0;
+  uint32_t triangleCount = 0;
+  Vec3f center{0.0f}; // bounding sphere
+  float radius = 0.0f;
+  Vec3f coneAxis{0.0f}; // unit average of the triangle normals; zero if they point every which way
+  float coneCutoff = 0.0f; // sine of the widest angle between coneAxis and any triangle normal
+};
+
+/**
+ * The triangles of a RawModel that become a single glTF primitive, as a view into the model.
+ * Vertices are not copied: the primitive lists the model vertices it uses, in local order, and its
+ * triangles index into that list.
+ */
+struct RawPrimitive {
+  int materialIndex;
+  int surfaceIndex; // the surface of its first triangle
+  int vertexAttributes; // the attributes its vertices actually carry
+  bool transparent = false; // drawn after the opaque primitives, back to front
+  int lodLevel = 0; // 0 at full detail, else the index of the lower level of detail it belongs to
+  std::vector<int> vertices; // local -> model vertex index
+  std::vector<uint32_t> indices; // three local vertex indices per triangle
+  Bounds<float, 3> bounds;
+  std::vector<RawMeshlet> meshlets; // consecutive triangle ranges, if meshlets were built
+
+  int GetVertexCount() const {
+    return (int)vertices.size();
+  }
+  int GetTriangleCount() const {
+    return (int)(indices.size() / 3);
+  }
 };
 
 class RawModel {
@@ -351,6 +539,9 @@ class RawModel {
   // Add geometry.
   void AddVertexAttribute(const RawVertexAttribute attrib);
   int AddVertex(const RawVertex& vertex);
+  // Add a vertex of a blend shape surface; blends holds one delta per RawSurface.blendChannels
+  // entry of the surface named by vertex.blendSurfaceIx.
+  int AddVertex(const RawVertex& vertex, const std::vector<RawBlendVertex>& blends);
   int AddTriangle(
       const int v0,
       const int v1,
@@ -404,15 +595,35 @@ class RawModel {
     return rootNodeId;
   }
 
+  // Point the nodes of surfaces that are exact copies of an earlier surface (same materials, vertex
+  // contents and skin, triangle for triangle) at that one, and drop the copies' triangles, for
+  // Condense() to clean up. Surfaces with blend shapes are left alone. Returns the copies merged.
+  int MergeDuplicateSurfaces();
+
   // Remove unused vertices, textures or materials after removing vertex attributes, textures,
   // materials or surfaces.
   void Condense();
 
-  void TransformGeometry(ComputeNormalsOption);
+  // Bake the meshes of nodes that no animation moves, neither theirs nor any ancestor's, into the
+  // space of the root node and gather them all into one surface, held by a new child of the root;
+  // CreatePrimitives() then makes a primitive per material of it. Skinned meshes and meshes with
+  // blend shapes stay where they are. Leaves the originals' triangles, where no other node uses
+  // them, for Condense() to clean up. Returns the number of meshes merged.
+  int MergeStaticSurfaces();
+
+  // Fold sibling nodes that hold the same static mesh into the first of them, as instances, and
+  // remove the others. Only childless nodes without skin, blend shapes, lights, cameras, user
+  // properties or animation qualify. Returns the number of nodes removed.
+  int FoldInstances();
+
+  void TransformGeometry(ComputeNormalsOption, ComputeTangentsOption);
 
-  void TransformTextures(const std::vector<std::function<Vec2f(Vec2f)>>& transforms);
+  void TransformTextures(const UVTransform& transform);
 
   size_t CalculateNormals(bool);
+  // Generate tangents for the vertices of triangles whose material has a normal texture, either
+  // all of them or only those that lack one. Returns the number of tangents generated.
+  size_t CalculateTangents(bool);
 
   // Get the attributes stored per vertex.
   int GetVertexAttributes() const {
@@ -421,11 +632,13 @@ class RawModel {
 
   // Iterate over the vertices.
   int GetVertexCount() const {
-    return (int)vertices.size();
+    return (int)streams.Count();
   }
-  const RawVertex& GetVertex(const int index) const {
-    return vertices[index];
+  RawVertex GetVertex(const int index) const {
+    return streams.Get(index, vertexAttributes);
   }
+  // The delta of a vertex in one blend channel of its surface; zero if it has none.
+  RawBlendVertex GetBlendVertex(const int index, const int channelIx) const;
 
   // Iterate over the triangles.
   int GetTriangleCount() const {
@@ -499,28 +712,44 @@ class RawModel {
   }
   int GetNodeById(const long nodeId) const;
 
-  // Create individual attribute arrays.
-  // Returns true if the vertices store the particular attribute.
+  // Access individual attribute arrays.
+  // The array is empty unless the vertices store the particular attribute.
+  template <typename _attrib_type_>
+  const std::vector<_attrib_type_>& GetAttributeArray(
+      const std::vector<_attrib_type_> RawVertexStreams::*ptr) const {
+    return streams.*ptr;
+  }
+  // Gather an attribute array for the vertices of a primitive, in its local order.
   template <typename _attrib_type_>
-  void GetAttributeArray(std::vector<_attrib_type_>& out, const _attrib_type_ RawVertex::* ptr)
-      const;
-
-  // Create an array with a raw model for each material.
-  // Multiple surfaces with the same material will turn into a single model.
-  // However, surfaces that are marked as 'discrete' will turn into separate models.
-  void CreateMaterialModels(
-      std::vector<RawModel>& materialModels,
+  void GetAttributeArray(
+      std::vector<_attrib_type_>& out,
+      const std::vector<_attrib_type_> RawVertexStreams::*ptr,
+      const RawPrimitive& primitive) const;
+
+  // Create an array with a primitive for each material.
+  // Multiple surfaces with the same material will turn into a single primitive.
+  // However, surfaces that are marked as 'discrete' will turn into separate primitives.
+  void CreatePrimitives(
+      std::vector<RawPrimitive>& primitives,
       bool shortIndices,
       const int keepAttribs,
       const bool forceDiscrete) const;
 
  private:
   Vec3f getFaceNormal(int verts[3]) const;
+  void RehashMaterials();
+  bool IsSameVertex(
+      const int index,
+      const RawVertex& vertex,
+      const std::vector<RawBlendVertex>& blends) const;
+  bool IsSameVertex(const int index, const int otherIndex, const int attributes) const;
+  void RehashVertices();
 
   long rootNodeId;
   int vertexAttributes;
-  std::unordered_map<RawVertex, int, VertexHasher> vertexHash;
-  std::vector<RawVertex> vertices;
+  VertexTable vertexHash;
+  RawVertexStreams streams;
+  std::vector<std::vector<RawBlendDeltas>> blendDeltas; // [surfaceIx][channelIx]
   std::vector<RawTriangle> triangles;
   std::vector<RawTexture> textures;
   std::vector<RawMaterial> materials;
@@ -529,14 +758,23 @@ class RawModel {
   std::vector<RawAnimation> animations;
   std::vector<RawCamera> cameras;
   std::vector<RawNode> nodes;
+  // id -> index lookups for the nodes and surfaces; the first entry with a given id wins
+  std::unordered_map<long, int> nodeIndexById;
+  std::unordered_map<long, int> surfaceIndexById;
+  // content hash -> index, used to intern materials, textures and lights as they are added
+  std::unordered_multimap<size_t, int> materialIndexByHash;
+  std::unordered_multimap<size_t, int> textureIndexByHash;
+  std::unordered_multimap<size_t, int> lightIndexByHash;
 };
 
 template <typename _attrib_type_>
 void RawModel::GetAttributeArray(
     std::vector<_attrib_type_>& out,
-    const _attrib_type_ RawVertex::* ptr) const {
-  out.resize(vertices.size());
-  for (size_t i = 0; i < vertices.size(); i++) {
-    out[i] = vertices[i].*ptr;
+    const std::vector<_attrib_type_> RawVertexStreams::*ptr,
+    const RawPrimitive& primitive) const {
+  const std::vector<_attrib_type_>& stream = streams.*ptr;
+  out.resize(primitive.vertices.size());
+  for (size_t i = 0; i < primitive.vertices.size(); i++) {
+    out[i] = stream[primitive.vertices[i]];
   }
 }
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <cctype>
 #include <cstdarg>
+#include <cstdint>
 #include <cstring>
 #include <string>
 
@@ -29,4 +30,16 @@ inline int CompareNoCase(const std::string& s1, const std::string& s2) {
   return strncasecmp(s1.c_str(), s2.c_str(), std::max(s1.length(), s2.length()));
 }
 
+// A hash that agrees with CompareNoCase(): strings that compare equal hash alike.
+inline size_t HashNoCase(const std::string& s) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const uint8_t c : s) {
+    if (c == '\0') {
+      break;
+    }
+    hash = (hash ^ (uint64_t)std::tolower(c)) * 1099511628211ull;
+  }
+  return (size_t)hash;
+}
+
 } // namespace StringUtils
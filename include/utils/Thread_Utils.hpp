@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ThreadUtils {
+
+// The most threads to use at once, or zero for one per hardware thread.
+inline unsigned threadLimit = 0;
+
+inline void SetThreadCount(const unsigned count) {
+  threadLimit = count;
+}
+
+inline unsigned GetThreadCount() {
+  return threadLimit > 0 ? threadLimit : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Split [0, count) into chunks of grain indices and call fn(begin, end) once per chunk, spread over
+ * worker threads. The chunk boundaries depend only on count and grain, never on the number of
+ * threads, so work that writes per-index results (or reduces per chunk) is deterministic.
+ */
+template <typename _fn_>
+void ParallelFor(const size_t count, const size_t grain, const _fn_& fn) {
+  const size_t chunkSize = std::max(grain, (size_t)1);
+  const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+  const size_t threadCount = std::min((size_t)GetThreadCount(), chunkCount);
+  if (threadCount <= 1) {
+    for (size_t begin = 0; begin < count; begin += chunkSize) {
+      fn(begin, std::min(begin + chunkSize, count));
+    }
+    return;
+  }
+
+  std::atomic<size_t> nextChunk(0);
+  const auto worker = [&]() {
+    for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+      const size_t begin = chunk * chunkSize;
+      fn(begin, std::min(begin + chunkSize, count));
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < threadCount; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace ThreadUtils
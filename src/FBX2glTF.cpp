@@ -19,6 +19,7 @@
 #include "fbx/Fbx2Raw.hpp"
 #include "gltf/Raw2Gltf.hpp"
 #include "utils/File_Utils.hpp"
+#include "utils/Thread_Utils.hpp"
 
 bool verboseOutput = false;
 
@@ -95,6 +96,68 @@ int main(int argc, char* argv[]) {
          "When to compute vertex normals from mesh geometry.")
       ->type_name("(never|broken|missing|always)");
 
+  app.add_option(
+         "--compute-tangents",
+         [&](std::vector<std::string> choices) -> bool {
+           for (const std::string choice : choices) {
+             if (choice == "never") {
+               gltfOptions.computeTangents = ComputeTangentsOption::NEVER;
+             } else if (choice == "missing") {
+               gltfOptions.computeTangents = ComputeTangentsOption::MISSING;
+             } else if (choice == "always") {
+               gltfOptions.computeTangents = ComputeTangentsOption::ALWAYS;
+             } else {
+               fmt::printf("Unknown --compute-tangents option: %s\n", choice);
+               throw CLI::RuntimeError(1);
+             }
+           }
+           return true;
+         },
+         "When to generate tangents for normal-mapped materials.")
+      ->type_name("(never|missing|always)");
+
+  app.add_flag(
+      "--optimize-vertex-cache",
+      gltfOptions.optimizeVertexCache,
+      "Reorder triangles for the GPU's post-transform vertex cache.");
+
+  app.add_option(
+         "--optimize-overdraw",
+         gltfOptions.optimizeOverdraw,
+         "Also reorder opaque triangles to reduce overdraw, within this vertex cache ACMR factor.")
+      ->type_name("FLOAT")
+      ->check(CLI::Range(1.0f, 3.0f));
+
+  app.add_flag(
+      "--meshlets",
+      gltfOptions.buildMeshlets,
+      "Describe meshlets of up to 64 vertices and 124 triangles, with culling data, in extras.");
+
+  app.add_flag(
+      "--merge-static",
+      gltfOptions.mergeStatic,
+      "Merge the meshes of all unanimated nodes into one mesh, with a primitive per material.");
+
+  app.add_flag(
+      "--gpu-instancing",
+      gltfOptions.gpuInstancing,
+      "Fold sibling nodes that share a static mesh into one EXT_mesh_gpu_instancing node.");
+
+  app.add_option(
+         "--lod",
+         gltfOptions.lod.ratios,
+         "Add MSFT_lod levels of detail, simplified to these fractions of the triangles.")
+      ->type_name("RATIO ...")
+      ->check(CLI::Range(0.0f, 1.0f));
+
+  app.add_option(
+         "--lod-error",
+         gltfOptions.lod.errors,
+         "The largest deviation, relative to the mesh size, allowed for each level of detail.")
+      ->type_name("FLOAT ...")
+      ->capture_default_str()
+      ->check(CLI::Range(0.0f, 1.0f));
+
   app.add_option(
          "--anim-framerate",
          [&](std::vector<std::string> choices) -> bool {
@@ -237,10 +300,182 @@ int main(int argc, char* argv[]) {
       ->check(CLI::Range(1, 32))
       ->group("Draco");
 
+  app.add_flag(
+         "--meshopt",
+         gltfOptions.meshopt.enabled,
+         "Apply EXT_meshopt_compression to geometry, morph targets and animations.")
+      ->group("Meshopt");
+
+  app.add_option(
+         "--meshopt-normal-filter",
+         [&](std::vector<std::string> choices) -> bool {
+           for (const std::string choice : choices) {
+             if (choice == "none") {
+               gltfOptions.meshopt.normalFilter = MeshoptFilter::NONE;
+             } else if (choice == "octahedral") {
+               gltfOptions.meshopt.normalFilter = MeshoptFilter::OCTAHEDRAL;
+             } else {
+               fmt::printf("Unknown --meshopt-normal-filter: %s\n", choice);
+               throw CLI::RuntimeError(1);
+             }
+           }
+           return true;
+         },
+         "How to filter normals and tangents before compression.")
+      ->type_name("(none|octahedral)")
+      ->group("Meshopt");
+
+  app.add_option(
+         "--meshopt-rotation-filter",
+         [&](std::vector<std::string> choices) -> bool {
+           for (const std::string choice : choices) {
+             if (choice == "none") {
+               gltfOptions.meshopt.rotationFilter = MeshoptFilter::NONE;
+             } else if (choice == "quaternion") {
+               gltfOptions.meshopt.rotationFilter = MeshoptFilter::QUATERNION;
+             } else {
+               fmt::printf("Unknown --meshopt-rotation-filter: %s\n", choice);
+               throw CLI::RuntimeError(1);
+             }
+           }
+           return true;
+         },
+         "How to filter animated rotations before compression.")
+      ->type_name("(none|quaternion)")
+      ->group("Meshopt");
+
+  app.add_option(
+         "--meshopt-delta-filter",
+         [&](std::vector<std::string> choices) -> bool {
+           for (const std::string choice : choices) {
+             if (choice == "none") {
+               gltfOptions.meshopt.deltaFilter = MeshoptFilter::NONE;
+             } else if (choice == "exponential") {
+               gltfOptions.meshopt.deltaFilter = MeshoptFilter::EXPONENTIAL;
+             } else {
+               fmt::printf("Unknown --meshopt-delta-filter: %s\n", choice);
+               throw CLI::RuntimeError(1);
+             }
+           }
+           return true;
+         },
+         "How to filter morph target deltas and animated translations/scales before compression.")
+      ->type_name("(none|exponential)")
+      ->group("Meshopt");
+
+  app.add_option(
+         "--meshopt-bits-for-normals",
+         gltfOptions.meshopt.bitsForNormals,
+         "How many bits the octahedral filter keeps per normal component.")
+      ->capture_default_str()
+      ->check(CLI::Range(4, 16))
+      ->group("Meshopt");
+
+  app.add_option(
+         "--meshopt-bits-for-rotations",
+         gltfOptions.meshopt.bitsForRotations,
+         "How many bits the quaternion filter keeps per rotation component.")
+      ->capture_default_str()
+      ->check(CLI::Range(4, 16))
+      ->group("Meshopt");
+
+  app.add_option(
+         "--meshopt-bits-for-deltas",
+         gltfOptions.meshopt.bitsForDeltas,
+         "How many mantissa bits the exponential filter keeps.")
+      ->capture_default_str()
+      ->check(CLI::Range(1, 24))
+      ->group("Meshopt");
+
+  app.add_flag(
+         "--quantize",
+         gltfOptions.quantize.enabled,
+         "Store vertex attributes as integers with KHR_mesh_quantization, unless Draco is used.")
+      ->group("Quantization");
+
+  app.add_option(
+         "--quantize-bits-for-position",
+         gltfOptions.quantize.quantBitsPosition,
+         "How many bits to quantize positions to.")
+      ->capture_default_str()
+      ->check(CLI::Range(2, 16))
+      ->group("Quantization");
+
+  app.add_option(
+         "--quantize-bits-for-uv",
+         gltfOptions.quantize.quantBitsTexCoord,
+         "How many bits to quantize UV coordinates to.")
+      ->capture_default_str()
+      ->check(CLI::Range(1, 16))
+      ->group("Quantization");
+
+  app.add_option(
+         "--quantize-bits-for-normals",
+         gltfOptions.quantize.quantBitsNormal,
+         "How many bits to quantize normals and tangents to.")
+      ->capture_default_str()
+      ->check(CLI::Range(2, 8))
+      ->group("Quantization");
+
+  app.add_flag(
+         "--anim-native-keys",
+         gltfOptions.animationNativeKeys,
+         "Export the keys of FBX animation curves as they are where glTF can reproduce them, "
+         "baking only the nodes that need it.")
+      ->group("Animation");
+
+  app.add_flag(
+         "--anim-parallel",
+         gltfOptions.parallelAnimations,
+         "Bake animation stacks in parallel, each thread from its own import of the FBX file.")
+      ->group("Animation");
+
+  app.add_flag(
+         "--anim-reduce",
+         gltfOptions.keyReduction.enabled,
+         "Drop the baked animation keys that interpolation reproduces within the tolerances.")
+      ->group("Animation");
+
+  app.add_option(
+         "--anim-reduce-translation-error",
+         gltfOptions.keyReduction.translationError,
+         "How far, in metres, an interpolated translation may stray from the baked one.")
+      ->type_name("FLOAT")
+      ->capture_default_str()
+      ->check(CLI::Range(0.0f, 1.0f))
+      ->group("Animation");
+
+  app.add_option(
+         "--anim-reduce-rotation-error",
+         gltfOptions.keyReduction.rotationError,
+         "How far, in degrees, an interpolated rotation may stray from the baked one.")
+      ->type_name("FLOAT")
+      ->capture_default_str()
+      ->check(CLI::Range(0.0f, 180.0f))
+      ->group("Animation");
+
+  app.add_option(
+         "--anim-reduce-scale-error",
+         gltfOptions.keyReduction.scaleError,
+         "How far an interpolated scale or morph target weight may stray from the baked one.")
+      ->type_name("FLOAT")
+      ->capture_default_str()
+      ->check(CLI::Range(0.0f, 1.0f))
+      ->group("Animation");
+
+  unsigned threadCount = 0;
+  app.add_option(
+         "--threads",
+         threadCount,
+         "The most threads to work with at once; 0 uses one per hardware thread.")
+      ->capture_default_str();
+
   app.add_option("--fbx-temp-dir", gltfOptions.fbxTempDir, "Temporary directory to be used by FBX SDK.")->check(CLI::ExistingDirectory);
 
   CLI11_PARSE(app, argc, argv);
 
+  ThreadUtils::SetThreadCount(threadCount);
+
   bool do_flip_u = false;
   bool do_flip_v = true;
   // somewhat tedious way to resolve --flag vs --no-flag in order provided
@@ -248,15 +483,11 @@ int main(int argc, char* argv[]) {
     do_flip_u = (do_flip_u || (opt == opt_flip_u)) && (opt != opt_no_flip_u);
     do_flip_v = (do_flip_v || (opt == opt_flip_v)) && (opt != opt_no_flip_v);
   }
-  std::vector<std::function<Vec2f(Vec2f)>> texturesTransforms;
-  if (do_flip_u || do_flip_v) {
-    if (do_flip_u && do_flip_v) {
-      texturesTransforms.emplace_back([](Vec2f uv) { return Vec2f(1.0 - uv[0], 1.0 - uv[1]); });
-    } else if (do_flip_u) {
-      texturesTransforms.emplace_back([](Vec2f uv) { return Vec2f(1.0 - uv[0], uv[1]); });
-    } else {
-      texturesTransforms.emplace_back([](Vec2f uv) { return Vec2f(uv[0], 1.0 - uv[1]); });
-    }
+  if (do_flip_u) {
+    gltfOptions.uvTransform = gltfOptions.uvTransform.Then(UVTransform::FlipU());
+  }
+  if (do_flip_v) {
+    gltfOptions.uvTransform = gltfOptions.uvTransform.Then(UVTransform::FlipV());
   }
   if (verboseOutput) {
     if (do_flip_u) {
@@ -331,11 +562,15 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  if (!texturesTransforms.empty()) {
-    raw.TransformTextures(texturesTransforms);
-  }
+  raw.MergeDuplicateSurfaces();
   raw.Condense();
-  raw.TransformGeometry(gltfOptions.computeNormals);
+  raw.TransformGeometry(gltfOptions.computeNormals, gltfOptions.computeTangents);
+  if (gltfOptions.mergeStatic && raw.MergeStaticSurfaces() > 0) {
+    raw.Condense();
+  }
+  if (gltfOptions.gpuInstancing) {
+    raw.FoldInstances();
+  }
 
   std::ofstream outStream; // note: auto-flushes in destructor
   const auto streamStart = outStream.tellp();
@@ -9,22 +9,28 @@
 #include <fbx/Fbx2Raw.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "FBX2glTF.h"
 
+#include <raw/AnimationReducer.hpp>
 #include <raw/RawModel.hpp>
 #include <utils/File_Utils.hpp>
 #include <utils/String_Utils.hpp>
+#include <utils/Thread_Utils.hpp>
 
 #include <fbx/FbxBlendShapesAccess.hpp>
 #include <fbx/FbxLayerElementAccess.hpp>
 #include <fbx/FbxSkinningAccess.hpp>
+#include <fbx/FbxTransformCache.hpp>
 #include <fbx/materials/RoughnessMetallicMaterials.hpp>
 #include <fbx/materials/TraditionalMaterials.hpp>
 
@@ -224,6 +230,9 @@ static void ReadMesh(
     }
   }
 
+  // the blend deltas of each corner, kept out here so their storage is reused across polygons
+  std::vector<RawBlendVertex> rawBlends[3];
+
   int polygonVertexIndex = 0;
   for (int polygonIndex = 0; polygonIndex < pMesh->GetPolygonCount(); polygonIndex++) {
     FBX_ASSERT(pMesh->GetPolygonSize(polygonIndex) == 3);
@@ -378,6 +387,7 @@ static void ReadMesh(
 
       rawSurface.bounds.AddPoint(vertex.position);
 
+      rawBlends[vertexIndex].clear();
       if (!targetShapes.empty()) {
         vertex.blendSurfaceIx = rawSurfaceIndex;
         for (const auto* targetShape : targetShapes) {
@@ -404,9 +414,9 @@ static void ReadMesh(
                 FbxVector4(0.0f, 0.0f, 0.0f, 0.0f),
                 inverseTransposeTransform,
                 true);
-            blendVertex.tangent = toVec4f(tangent - fbxTangent);
+            blendVertex.tangent = toVec3f(tangent - fbxTangent);
           }
-          vertex.blends.push_back(blendVertex);
+          rawBlends[vertexIndex].push_back(blendVertex);
         }
       } else {
         vertex.blendSurfaceIx = -1;
@@ -460,7 +470,8 @@ static void ReadMesh(
 
     int rawVertexIndices[3];
     for (int vertexIndex = 0; vertexIndex < 3; vertexIndex++) {
-      rawVertexIndices[vertexIndex] = raw.AddVertex(rawVertices[vertexIndex]);
+      rawVertexIndices[vertexIndex] =
+          raw.AddVertex(rawVertices[vertexIndex], rawBlends[vertexIndex]);
     }
 
     const RawMaterialType materialType =
@@ -664,11 +675,12 @@ static void ReadNodeAttributes(
 }
 
 /**
- * Compute the local scale vector to use for a given node. This is an imperfect hack to cope with
- * the FBX node transform's eInheritRrs inheritance type, in which ancestral scale is ignored
+ * Compute the local scale vector to use for a given node, given its evaluated local transform.
+ * This is an imperfect hack to cope with the FBX node transform's eInheritRrs inheritance type,
+ * in which ancestral scale is ignored
  */
-static FbxVector4 computeLocalScale(FbxNode* pNode, FbxTime pTime = FBXSDK_TIME_INFINITE) {
-  const FbxVector4 lScale = pNode->EvaluateLocalTransform(pTime).GetS();
+static FbxVector4 computeLocalScale(FbxNode* pNode, const FbxAMatrix& localTransform) {
+  const FbxVector4 lScale = localTransform.GetS();
 
   if (pNode->GetParent() == nullptr ||
       pNode->GetTransform().GetInheritType() != FbxTransform::eInheritRrs) {
@@ -689,7 +701,9 @@ static void ReadNodeHierarchy(
     const std::string& path) {
   const FbxUInt64 nodeId = pNode->GetUniqueID();
   const char* nodeName = pNode->GetName();
+  const int prevNodeCount = raw.GetNodeCount();
   const int nodeIndex = raw.AddNode(nodeId, nodeName, parentId);
+  const bool isNewNode = raw.GetNodeCount() > prevNodeCount;
   RawNode& node = raw.GetNode(nodeIndex);
 
   FbxTransform::EInheritType lInheritType;
@@ -725,7 +739,7 @@ static void ReadNodeHierarchy(
   const FbxAMatrix localTransform = pNode->EvaluateLocalTransform();
   const FbxVector4 localTranslation = localTransform.GetT();
   const FbxQuaternion localRotation = localTransform.GetQ();
-  const FbxVector4 localScaling = computeLocalScale(pNode);
+  const FbxVector4 localScaling = computeLocalScale(pNode, localTransform);
 
   node.translation = toVec3f(localTranslation) * scaleFactor;
   node.rotation = toQuatf(localRotation);
@@ -733,9 +747,10 @@ static void ReadNodeHierarchy(
 
   if (parentId) {
     RawNode& parentNode = raw.GetNode(raw.GetNodeById(parentId));
-    // Add unique child name to the parent node.
-    if (std::find(parentNode.childIds.begin(), parentNode.childIds.end(), nodeId) ==
-        parentNode.childIds.end()) {
+    // Add unique child name to the parent node; a node we just created can't be listed yet.
+    if (isNewNode ||
+        std::find(parentNode.childIds.begin(), parentNode.childIds.end(), nodeId) ==
+            parentNode.childIds.end()) {
       parentNode.childIds.push_back(nodeId);
     }
   } else {
@@ -748,7 +763,334 @@ static void ReadNodeHierarchy(
   }
 }
 
-static void ReadAnimations(RawModel& raw, FbxScene* pScene, const GltfOptions& options) {
+/**
+ * Whether the keys of a curve can be carried over to glTF as they are: the curve must hold its end
+ * values outside its keys, as glTF does, its constant keys must hold their own value, and its cubic
+ * keys must make plain Hermite segments, without weights or velocities.
+ */
+static bool IsCurveExportable(FbxAnimCurve* curve, const FbxTime& startTime) {
+  if (curve->GetPreExtrapolation() != FbxAnimCurveBase::eConstant ||
+      curve->GetPostExtrapolation() != FbxAnimCurveBase::eConstant) {
+    return false;
+  }
+  for (int keyIx = 0; keyIx < curve->KeyGetCount(); keyIx++) {
+    if (curve->KeyGetTime(keyIx) < startTime) {
+      return false;
+    }
+    switch (curve->KeyGetInterpolation(keyIx)) {
+      case FbxAnimCurveDef::eInterpolationConstant:
+        if (curve->KeyGetConstantMode(keyIx) != FbxAnimCurveDef::eConstantStandard) {
+          return false;
+        }
+        break;
+      case FbxAnimCurveDef::eInterpolationCubic:
+        if (curve->KeyGetTangentWeightMode(keyIx) != FbxAnimCurveDef::eWeightedNone ||
+            curve->KeyGetTangentVelocityMode(keyIx) != FbxAnimCurveDef::eVelocityNone) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+// The interpolations of the segments between the keys of some curves, as a bitmask.
+static int GetSegmentInterpolations(FbxAnimCurve* const curves[3]) {
+  int interpolations = 0;
+  for (int component = 0; component < 3; component++) {
+    for (int keyIx = 0; curves[component] && keyIx + 1 < curves[component]->KeyGetCount();
+         keyIx++) {
+      interpolations |= curves[component]->KeyGetInterpolation(keyIx);
+    }
+  }
+  return interpolations;
+}
+
+static std::vector<FbxTime> GetUnionOfKeyTimes(FbxAnimCurve* const curves[3]) {
+  std::set<FbxLongLong> keyTimes;
+  for (int component = 0; component < 3; component++) {
+    for (int keyIx = 0; curves[component] && keyIx < curves[component]->KeyGetCount(); keyIx++) {
+      keyTimes.insert(curves[component]->KeyGetTime(keyIx).Get());
+    }
+  }
+  return std::vector<FbxTime>(keyTimes.begin(), keyTimes.end());
+}
+
+/**
+ * The derivative, in units per second, of a curve just left or right of a time, which may fall on
+ * a key of the curve or between them.
+ */
+static double GetCurveDerivative(FbxAnimCurve* curve, const FbxTime& time, const bool right) {
+  const int keyCount = curve->KeyGetCount();
+  int nextKeyIx = 0;
+  while (nextKeyIx < keyCount && curve->KeyGetTime(nextKeyIx) <= time) {
+    nextKeyIx++;
+  }
+  const bool onKey = nextKeyIx > 0 && curve->KeyGetTime(nextKeyIx - 1) == time;
+  // the segment runs from key segmentIx to the next one
+  const int segmentIx = (onKey && !right) ? nextKeyIx - 2 : nextKeyIx - 1;
+  if (segmentIx < 0 || segmentIx + 1 >= keyCount) {
+    // the curve holds its end values
+    return 0.0;
+  }
+  const FbxTime segmentStart = curve->KeyGetTime(segmentIx);
+  const FbxTime segmentEnd = curve->KeyGetTime(segmentIx + 1);
+  switch (curve->KeyGetInterpolation(segmentIx)) {
+    case FbxAnimCurveDef::eInterpolationLinear:
+      return (curve->KeyGetValue(segmentIx + 1) - curve->KeyGetValue(segmentIx)) /
+          (segmentEnd - segmentStart).GetSecondDouble();
+    case FbxAnimCurveDef::eInterpolationCubic:
+      if (onKey) {
+        return right ? curve->KeyGetRightDerivative(segmentIx)
+                     : curve->KeyGetLeftDerivative(segmentIx + 1);
+      } else {
+        // another curve keys this time; a central difference well inside the segment will do
+        const double step = std::min(
+            1e-3,
+            0.25 *
+                std::min(
+                    (time - segmentStart).GetSecondDouble(),
+                    (segmentEnd - time).GetSecondDouble()));
+        FbxTime before, after;
+        before.SetSecondDouble(time.GetSecondDouble() - step);
+        after.SetSecondDouble(time.GetSecondDouble() + step);
+        return (curve->Evaluate(after) - curve->Evaluate(before)) / (2.0 * step);
+      }
+    default:
+      return 0.0;
+  }
+}
+
+/**
+ * Reads the keys of the curves animating the components of a vector property, or null for static
+ * components, at the union of their key times: as STEP if all are constant, LINEAR if all are
+ * linear, and CUBICSPLINE if some are cubic, with the curve derivatives as tangents. Returns false
+ * if no glTF interpolation reproduces the curves.
+ */
+static bool ReadNativeVectorKeys(
+    FbxAnimCurve* const curves[3],
+    const FbxDouble3& staticValue,
+    const FbxTime& startTime,
+    const double scale,
+    std::vector<Vec3f>& values,
+    RawKeyTiming& timing) {
+  const int interpolations = GetSegmentInterpolations(curves);
+  if (interpolations == FbxAnimCurveDef::eInterpolationConstant) {
+    timing.interpolation = RAW_INTERPOLATION_STEP;
+  } else if ((interpolations & FbxAnimCurveDef::eInterpolationConstant) != 0) {
+    // a held value jumps at the next key, which neither LINEAR nor CUBICSPLINE can do
+    return false;
+  } else if ((interpolations & FbxAnimCurveDef::eInterpolationCubic) != 0) {
+    timing.interpolation = RAW_INTERPOLATION_CUBICSPLINE;
+  } else {
+    timing.interpolation = RAW_INTERPOLATION_LINEAR;
+  }
+
+  auto evaluate = [&](const FbxTime& time, const int derivative) {
+    Vec3f result;
+    for (int component = 0; component < 3; component++) {
+      FbxAnimCurve* curve = curves[component];
+      double value = 0.0;
+      if (derivative != 0) {
+        value = curve ? GetCurveDerivative(curve, time, derivative > 0) : 0.0;
+      } else {
+        value = curve ? curve->Evaluate(time) : staticValue[component];
+      }
+      result[component] = static_cast<float>(value * scale);
+    }
+    return result;
+  };
+
+  for (const FbxTime& time : GetUnionOfKeyTimes(curves)) {
+    timing.times.push_back(static_cast<float>((time - startTime).GetSecondDouble()));
+    if (timing.interpolation == RAW_INTERPOLATION_CUBICSPLINE) {
+      values.push_back(evaluate(time, -1));
+      values.push_back(evaluate(time, 0));
+      values.push_back(evaluate(time, 1));
+    } else {
+      values.push_back(evaluate(time, 0));
+    }
+  }
+  return true;
+}
+
+/**
+ * Reads the keys of the Euler curves of a node's rotation as quaternions, at the union of their key
+ * times. glTF interpolates rotations spherically, which only agrees with the curves when all of
+ * them are constant (STEP), or when they turn about a single axis, linearly and by less than half a
+ * turn from key to key (LINEAR).
+ */
+static bool ReadNativeRotationKeys(
+    FbxNode* pNode,
+    FbxAnimCurve* const curves[3],
+    const FbxTime& startTime,
+    std::vector<Quatf>& values,
+    RawKeyTiming& timing) {
+  const int interpolations = GetSegmentInterpolations(curves);
+  if (interpolations == FbxAnimCurveDef::eInterpolationConstant) {
+    timing.interpolation = RAW_INTERPOLATION_STEP;
+  } else if (interpolations == 0 || interpolations == FbxAnimCurveDef::eInterpolationLinear) {
+    timing.interpolation = RAW_INTERPOLATION_LINEAR;
+    int turningCurves = 0;
+    for (int component = 0; component < 3; component++) {
+      FbxAnimCurve* curve = curves[component];
+      bool turns = false;
+      for (int keyIx = 0; curve && keyIx + 1 < curve->KeyGetCount(); keyIx++) {
+        const double turn = curve->KeyGetValue(keyIx + 1) - curve->KeyGetValue(keyIx);
+        if (fabs(turn) >= 180.0) {
+          return false;
+        }
+        turns |= (turn != 0.0);
+      }
+      turningCurves += turns ? 1 : 0;
+    }
+    if (turningCurves > 1) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  FbxQuaternion previous;
+  for (const FbxTime& time : GetUnionOfKeyTimes(curves)) {
+    FbxQuaternion rotation = pNode->EvaluateLocalTransform(time).GetQ();
+    // keep neighbouring keys in the same hemisphere, so they interpolate the short way round
+    if (!values.empty() &&
+        rotation[0] * previous[0] + rotation[1] * previous[1] + rotation[2] * previous[2] +
+                rotation[3] * previous[3] <
+            0.0) {
+      rotation = FbxQuaternion(-rotation[0], -rotation[1], -rotation[2], -rotation[3]);
+    }
+    timing.times.push_back(static_cast<float>((time - startTime).GetSecondDouble()));
+    values.push_back(toQuatf(rotation));
+    previous = rotation;
+  }
+  return true;
+}
+
+/**
+ * Reads a node's animation from the keys of its translation, rotation and scaling curves in the
+ * given layer, rather than by sampling it. Returns false, leaving the channel be, if the node has
+ * no such curves, or needs baking: for pivots, offsets, pre- or post-rotation, an inheritance glTF
+ * lacks, blend shapes, or curves that glTF interpolation can't reproduce.
+ */
+static bool ReadNativeChannel(
+    FbxNode* pNode,
+    FbxAnimLayer* pAnimLayer,
+    const FbxTime& startTime,
+    RawChannel& channel) {
+  auto isZero = [](const FbxVector4& v) { return v[0] == 0.0 && v[1] == 0.0 && v[2] == 0.0; };
+  if (!isZero(pNode->GetRotationOffset(FbxNode::eSourcePivot)) ||
+      !isZero(pNode->GetRotationPivot(FbxNode::eSourcePivot)) ||
+      !isZero(pNode->GetScalingOffset(FbxNode::eSourcePivot)) ||
+      !isZero(pNode->GetScalingPivot(FbxNode::eSourcePivot))) {
+    return false;
+  }
+  if (pNode->RotationActive.Get() &&
+      (!isZero(pNode->GetPreRotation(FbxNode::eSourcePivot)) ||
+       !isZero(pNode->GetPostRotation(FbxNode::eSourcePivot)))) {
+    return false;
+  }
+  if (pNode->GetTransform().GetInheritType() != FbxTransform::eInheritRSrs) {
+    return false;
+  }
+  const FbxMesh* pMesh = pNode->GetMesh();
+  if (pMesh != nullptr && pMesh->GetDeformerCount(FbxDeformer::eBlendShape) > 0) {
+    return false;
+  }
+
+  bool hasCurves = false;
+  bool exportable = true;
+  auto getCurves = [&](FbxPropertyT<FbxDouble3>& property, FbxAnimCurve* curves[3]) {
+    const char* components[] = {
+        FBXSDK_CURVENODE_COMPONENT_X, FBXSDK_CURVENODE_COMPONENT_Y, FBXSDK_CURVENODE_COMPONENT_Z};
+    for (int component = 0; component < 3; component++) {
+      curves[component] = property.GetCurve(pAnimLayer, components[component]);
+      if (curves[component] != nullptr && curves[component]->KeyGetCount() == 0) {
+        curves[component] = nullptr;
+      }
+      if (curves[component] != nullptr) {
+        hasCurves = true;
+        exportable &= IsCurveExportable(curves[component], startTime);
+      }
+    }
+    return curves[0] || curves[1] || curves[2];
+  };
+  FbxAnimCurve* translationCurves[3];
+  FbxAnimCurve* rotationCurves[3];
+  FbxAnimCurve* scalingCurves[3];
+  const bool hasTranslation = getCurves(pNode->LclTranslation, translationCurves);
+  const bool hasRotation = getCurves(pNode->LclRotation, rotationCurves);
+  const bool hasScale = getCurves(pNode->LclScaling, scalingCurves);
+  if (!hasCurves || !exportable) {
+    return false;
+  }
+
+  RawChannel native;
+  native.nodeIndex = channel.nodeIndex;
+  if (hasTranslation &&
+      !ReadNativeVectorKeys(
+          translationCurves,
+          pNode->LclTranslation.Get(),
+          startTime,
+          scaleFactor,
+          native.translations,
+          native.translationTiming)) {
+    return false;
+  }
+  if (hasRotation &&
+      !ReadNativeRotationKeys(
+          pNode, rotationCurves, startTime, native.rotations, native.rotationTiming)) {
+    return false;
+  }
+  if (hasScale &&
+      !ReadNativeVectorKeys(
+          scalingCurves,
+          pNode->LclScaling.Get(),
+          startTime,
+          1.0,
+          native.scales,
+          native.scaleTiming)) {
+    return false;
+  }
+  channel = native;
+  return true;
+}
+
+/**
+ * Whether a node's local transform may change in a stack that animates the given nodes: if the node
+ * is animated itself, or if it inherits transforms in a way that makes its local transform depend
+ * on its parent's, and an ancestor is animated.
+ */
+static bool IsTransformAnimated(FbxNode* pNode, const std::set<const FbxNode*>& animatedNodes) {
+  if (animatedNodes.count(pNode) > 0) {
+    return true;
+  }
+  if (pNode->GetTransform().GetInheritType() == FbxTransform::eInheritRSrs) {
+    return false;
+  }
+  for (FbxNode* pAncestor = pNode->GetParent(); pAncestor != nullptr;
+       pAncestor = pAncestor->GetParent()) {
+    if (animatedNodes.count(pAncestor) > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Bakes the animation of one stack, or reads its curve keys where asked to and possible. Scene
+ * nodes are matched to raw nodes by their index in the scene, so the stack may come from another
+ * import of the same file.
+ */
+static RawAnimation ReadAnimation(
+    FbxScene* pScene,
+    const int animIx,
+    const std::vector<int>& rawNodeIndices,
+    const GltfOptions& options,
+    const bool showProgress) {
   FbxTime::EMode eMode = FbxTime::eFrames24;
   switch (options.animationFramerate) {
     case AnimationFramerateOptions::BAKE24:
@@ -763,228 +1105,456 @@ static void ReadAnimations(RawModel& raw, FbxScene* pScene, const GltfOptions& o
   }
   const double epsilon = 1e-5f;
 
-  const int animationCount = pScene->GetSrcObjectCount<FbxAnimStack>();
-  for (size_t animIx = 0; animIx < animationCount; animIx++) {
-    FbxAnimStack* pAnimStack = pScene->GetSrcObject<FbxAnimStack>(animIx);
-    FbxString animStackName = pAnimStack->GetName();
-
-    pScene->SetCurrentAnimationStack(pAnimStack);
-
-    /**
-     * Individual animations are often concatenated on the timeline, and the
-     * only certain way to identify precisely what interval they occupy is to
-     * depth-traverse the entire animation stack, and examine the actual keys.
-     *
-     * There is a deprecated concept of an "animation take" which is meant to
-     * provide precisely this time interval information, but the data is not
-     * actually derived by the SDK from source-of-truth data structures, but
-     * rather provided directly by the FBX exporter, and not sanity checked.
-     *
-     * Some exporters calculate it correctly. Others do not. In any case, we
-     * now ignore it completely.
-     */
-    FbxLongLong firstFrameIndex = -1;
-    FbxLongLong lastFrameIndex = -1;
-    for (int layerIx = 0; layerIx < pAnimStack->GetMemberCount(); layerIx++) {
-      FbxAnimLayer* layer = pAnimStack->GetMember<FbxAnimLayer>(layerIx);
-      for (int nodeIx = 0; nodeIx < layer->GetMemberCount(); nodeIx++) {
-        auto* node = layer->GetMember<FbxAnimCurveNode>(nodeIx);
-        FbxTimeSpan nodeTimeSpan;
-        // Multiple curves per curve node is not even supported by the SDK.
-        for (int curveIx = 0; curveIx < node->GetCurveCount(0); curveIx++) {
-          FbxAnimCurve* curve = node->GetCurve(0U, curveIx);
-          if (curve == nullptr) {
-            continue;
-          }
-          // simply take the interval as first key to last key
-          int firstKeyIndex = 0;
-          int lastKeyIndex = std::max(firstKeyIndex, curve->KeyGetCount() - 1);
-          FbxLongLong firstCurveFrame = curve->KeyGetTime(firstKeyIndex).GetFrameCount(eMode);
-          FbxLongLong lastCurveFrame = curve->KeyGetTime(lastKeyIndex).GetFrameCount(eMode);
-
-          // the final interval is the union of all node curve intervals
-          if (firstFrameIndex == -1 || firstCurveFrame < firstFrameIndex) {
-            firstFrameIndex = firstCurveFrame;
-          }
-          if (lastFrameIndex == -1 || lastCurveFrame > lastFrameIndex) {
-            lastFrameIndex = lastCurveFrame;
-          }
+  FbxAnimStack* pAnimStack = pScene->GetSrcObject<FbxAnimStack>(animIx);
+  FbxString animStackName = pAnimStack->GetName();
+
+  pScene->SetCurrentAnimationStack(pAnimStack);
+
+  /**
+   * Individual animations are often concatenated on the timeline, and the
+   * only certain way to identify precisely what interval they occupy is to
+   * depth-traverse the entire animation stack, and examine the actual keys.
+   *
+   * There is a deprecated concept of an "animation take" which is meant to
+   * provide precisely this time interval information, but the data is not
+   * actually derived by the SDK from source-of-truth data structures, but
+   * rather provided directly by the FBX exporter, and not sanity checked.
+   *
+   * Some exporters calculate it correctly. Others do not. In any case, we
+   * now ignore it completely.
+   */
+  FbxLongLong firstFrameIndex = -1;
+  FbxLongLong lastFrameIndex = -1;
+  // while we're at it, note the scene nodes whose properties the stack animates
+  std::set<const FbxNode*> animatedNodes;
+  for (int layerIx = 0; layerIx < pAnimStack->GetMemberCount(); layerIx++) {
+    FbxAnimLayer* layer = pAnimStack->GetMember<FbxAnimLayer>(layerIx);
+    for (int nodeIx = 0; nodeIx < layer->GetMemberCount(); nodeIx++) {
+      auto* node = layer->GetMember<FbxAnimCurveNode>(nodeIx);
+      for (int propertyIx = 0; propertyIx < node->GetDstPropertyCount(); propertyIx++) {
+        const FbxNode* pAnimatedNode =
+            FbxCast<FbxNode>(node->GetDstProperty(propertyIx).GetFbxObject());
+        if (pAnimatedNode != nullptr) {
+          animatedNodes.insert(pAnimatedNode);
+        }
+      }
+      FbxTimeSpan nodeTimeSpan;
+      // Multiple curves per curve node is not even supported by the SDK.
+      for (int curveIx = 0; curveIx < node->GetCurveCount(0); curveIx++) {
+        FbxAnimCurve* curve = node->GetCurve(0U, curveIx);
+        if (curve == nullptr) {
+          continue;
+        }
+        // simply take the interval as first key to last key
+        int firstKeyIndex = 0;
+        int lastKeyIndex = std::max(firstKeyIndex, curve->KeyGetCount() - 1);
+        FbxLongLong firstCurveFrame = curve->KeyGetTime(firstKeyIndex).GetFrameCount(eMode);
+        FbxLongLong lastCurveFrame = curve->KeyGetTime(lastKeyIndex).GetFrameCount(eMode);
+
+        // the final interval is the union of all node curve intervals
+        if (firstFrameIndex == -1 || firstCurveFrame < firstFrameIndex) {
+          firstFrameIndex = firstCurveFrame;
+        }
+        if (lastFrameIndex == -1 || lastCurveFrame > lastFrameIndex) {
+          lastFrameIndex = lastCurveFrame;
         }
       }
     }
-    RawAnimation animation;
-    animation.name = animStackName;
+  }
+  RawAnimation animation;
+  animation.name = animStackName;
 
-    fmt::printf(
-        "Animation %s: [%lu - %lu]\n", std::string(animStackName), firstFrameIndex, lastFrameIndex);
+  fmt::printf(
+      "Animation %s: [%lu - %lu]\n", std::string(animStackName), firstFrameIndex, lastFrameIndex);
 
-    if (verboseOutput) {
-      fmt::printf("animation %zu: %s (%d%%)", animIx, (const char*)animStackName, 0);
+  if (showProgress) {
+    fmt::printf("animation %d: %s (%d%%)", animIx, (const char*)animStackName, 0);
+  }
+
+  for (FbxLongLong frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex; frameIndex++) {
+    FbxTime pTime;
+    // first frame is always at t = 0.0
+    pTime.SetFrame(frameIndex - firstFrameIndex, eMode);
+    animation.times.emplace_back((float)pTime.GetSecondDouble());
+  }
+
+  size_t totalSizeInBytes = 0;
+
+  // Curve keys only tell the whole story when a single layer animates the stack.
+  FbxAnimLayer* pNativeLayer = nullptr;
+  if (options.animationNativeKeys && pAnimStack->GetMemberCount<FbxAnimLayer>() == 1) {
+    pNativeLayer = pAnimStack->GetMember<FbxAnimLayer>(0);
+  }
+  FbxTime startTime;
+  startTime.SetFrame(firstFrameIndex, eMode);
+  size_t nativeChannelCount = 0;
+
+  // First settle how each node that changes in this stack gets its channel: from its curve keys,
+  // or by baking its transform and/or its blend shape weights.
+  struct NodeAnimation {
+    FbxNode* pNode = nullptr;
+    RawChannel channel;
+    bool native = false;
+    bool bakeTransform = false;
+    // the blend shape channels keyed in this stack, or empty if none is
+    std::vector<FbxAnimCurve*> shapeAnimCurves;
+    bool hasTranslation = false;
+    bool hasRotation = false;
+    bool hasScale = false;
+  };
+  std::vector<NodeAnimation> nodeAnimations;
+
+  const int nodeCount = pScene->GetNodeCount();
+  for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
+    FbxNode* pNode = pScene->GetNode(nodeIndex);
+    const bool transformAnimated = IsTransformAnimated(pNode, animatedNodes);
+
+    // the blend shape channels with keys in this stack; it's inelegant to recreate this same access
+    // class multiple times, but it's also dirt cheap...
+    std::vector<FbxAnimCurve*> shapeAnimCurves;
+    bool morphsAnimated = false;
+    FbxNodeAttribute* nodeAttr = pNode->GetNodeAttribute();
+    if (nodeAttr != nullptr && nodeAttr->GetAttributeType() == FbxNodeAttribute::EType::eMesh) {
+      FbxBlendShapesAccess blendShapes(static_cast<FbxMesh*>(nodeAttr));
+      for (size_t channelIx = 0; channelIx < blendShapes.GetChannelCount(); channelIx++) {
+        FbxAnimCurve* curve = blendShapes.GetAnimation(channelIx, animIx);
+        if (curve != nullptr && curve->KeyGetCount() == 0) {
+          curve = nullptr;
+        }
+        shapeAnimCurves.push_back(curve);
+        morphsAnimated |= (curve != nullptr);
+      }
+    }
+
+    if (!transformAnimated && !morphsAnimated) {
+      // nothing about this node can change, so don't spend a single evaluation on it
+      continue;
+    }
+
+    NodeAnimation nodeAnimation;
+    nodeAnimation.pNode = pNode;
+    nodeAnimation.channel.nodeIndex = rawNodeIndices[nodeIndex];
+    nodeAnimation.native = pNativeLayer != nullptr && transformAnimated &&
+        ReadNativeChannel(pNode, pNativeLayer, startTime, nodeAnimation.channel);
+    nodeAnimation.bakeTransform = transformAnimated && !nodeAnimation.native;
+    if (morphsAnimated) {
+      nodeAnimation.shapeAnimCurves = shapeAnimCurves;
+    }
+    nodeAnimations.push_back(std::move(nodeAnimation));
+  }
+
+  // Then bake the transforms a frame at a time, for all nodes at once: the cache evaluates each
+  // global transform once per frame, parents first, and derives local transforms from those.
+  std::vector<NodeAnimation*> bakedNodeAnimations;
+  std::vector<FbxNode*> bakedNodes;
+  for (NodeAnimation& nodeAnimation : nodeAnimations) {
+    if (nodeAnimation.bakeTransform) {
+      bakedNodeAnimations.push_back(&nodeAnimation);
+      bakedNodes.push_back(nodeAnimation.pNode);
+    }
+  }
+  if (!bakedNodes.empty()) {
+    FbxTransformCache transforms(bakedNodes);
+
+    struct BaseTransform {
+      FbxVector4 translation;
+      FbxQuaternion rotation;
+      FbxVector4 scaling;
+    };
+    std::vector<BaseTransform> baseTransforms;
+    transforms.Evaluate(FBXSDK_TIME_INFINITE);
+    for (FbxNode* pNode : bakedNodes) {
+      const FbxAMatrix baseTransform = transforms.GetLocalTransform(pNode);
+      baseTransforms.push_back(
+          {baseTransform.GetT(), baseTransform.GetQ(), computeLocalScale(pNode, baseTransform)});
     }
 
     for (FbxLongLong frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex; frameIndex++) {
       FbxTime pTime;
-      // first frame is always at t = 0.0
-      pTime.SetFrame(frameIndex - firstFrameIndex, eMode);
-      animation.times.emplace_back((float)pTime.GetSecondDouble());
-    }
+      pTime.SetFrame(frameIndex, eMode);
+      transforms.Evaluate(pTime);
+
+      for (size_t bakedIx = 0; bakedIx < bakedNodes.size(); bakedIx++) {
+        NodeAnimation& nodeAnimation = *bakedNodeAnimations[bakedIx];
+        const BaseTransform& base = baseTransforms[bakedIx];
+
+        const FbxAMatrix localTransform = transforms.GetLocalTransform(bakedNodes[bakedIx]);
+        const FbxVector4 localTranslation = localTransform.GetT();
+        const FbxQuaternion localRotation = localTransform.GetQ();
+        const FbxVector4 localScale = computeLocalScale(bakedNodes[bakedIx], localTransform);
+
+        nodeAnimation.hasTranslation |=
+            (fabs(localTranslation[0] - base.translation[0]) > epsilon ||
+             fabs(localTranslation[1] - base.translation[1]) > epsilon ||
+             fabs(localTranslation[2] - base.translation[2]) > epsilon);
+        nodeAnimation.hasRotation |=
+            (fabs(localRotation[0] - base.rotation[0]) > epsilon ||
+             fabs(localRotation[1] - base.rotation[1]) > epsilon ||
+             fabs(localRotation[2] - base.rotation[2]) > epsilon ||
+             fabs(localRotation[3] - base.rotation[3]) > epsilon);
+        nodeAnimation.hasScale |=
+            (fabs(localScale[0] - base.scaling[0]) > epsilon ||
+             fabs(localScale[1] - base.scaling[1]) > epsilon ||
+             fabs(localScale[2] - base.scaling[2]) > epsilon);
+
+        nodeAnimation.channel.translations.push_back(toVec3f(localTranslation) * scaleFactor);
+        nodeAnimation.channel.rotations.push_back(toQuatf(localRotation));
+        nodeAnimation.channel.scales.push_back(toVec3f(localScale));
+      }
 
-    size_t totalSizeInBytes = 0;
+      if (showProgress) {
+        fmt::printf(
+            "\ranimation %d: %s (%d%%)",
+            animIx,
+            (const char*)animStackName,
+            (int)((frameIndex - firstFrameIndex) * 100 / (lastFrameIndex - firstFrameIndex + 1)));
+      }
+    }
+  }
 
-    const int nodeCount = pScene->GetNodeCount();
-    for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
-      FbxNode* pNode = pScene->GetNode(nodeIndex);
-      const FbxAMatrix baseTransform = pNode->EvaluateLocalTransform();
-      const FbxVector4 baseTranslation = baseTransform.GetT();
-      const FbxQuaternion baseRotation = baseTransform.GetQ();
-      const FbxVector4 baseScaling = computeLocalScale(pNode);
-      bool hasTranslation = false;
-      bool hasRotation = false;
-      bool hasScale = false;
-      bool hasMorphs = false;
+  // Finally bake the blend shape weights, and keep the channels in which anything changes.
+  for (NodeAnimation& nodeAnimation : nodeAnimations) {
+    RawChannel& channel = nodeAnimation.channel;
+    if (nodeAnimation.native) {
+      animation.channels.emplace_back(channel);
+      nativeChannelCount++;
+
+      totalSizeInBytes += channel.translations.size() * sizeof(channel.translations[0]) +
+          channel.rotations.size() * sizeof(channel.rotations[0]) +
+          channel.scales.size() * sizeof(channel.scales[0]);
+      continue;
+    }
+    const bool hasTranslation = nodeAnimation.hasTranslation;
+    const bool hasRotation = nodeAnimation.hasRotation;
+    const bool hasScale = nodeAnimation.hasScale;
 
-      RawChannel channel;
-      channel.nodeIndex = raw.GetNodeById(pNode->GetUniqueID());
+    bool hasMorphs = false;
+    if (!nodeAnimation.shapeAnimCurves.empty()) {
+      FbxBlendShapesAccess blendShapes(
+          static_cast<FbxMesh*>(nodeAnimation.pNode->GetNodeAttribute()));
 
       for (FbxLongLong frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex; frameIndex++) {
         FbxTime pTime;
         pTime.SetFrame(frameIndex, eMode);
 
-        const FbxAMatrix localTransform = pNode->EvaluateLocalTransform(pTime);
-        const FbxVector4 localTranslation = localTransform.GetT();
-        const FbxQuaternion localRotation = localTransform.GetQ();
-        const FbxVector4 localScale = computeLocalScale(pNode, pTime);
-
-        hasTranslation |=
-            (fabs(localTranslation[0] - baseTranslation[0]) > epsilon ||
-             fabs(localTranslation[1] - baseTranslation[1]) > epsilon ||
-             fabs(localTranslation[2] - baseTranslation[2]) > epsilon);
-        hasRotation |=
-            (fabs(localRotation[0] - baseRotation[0]) > epsilon ||
-             fabs(localRotation[1] - baseRotation[1]) > epsilon ||
-             fabs(localRotation[2] - baseRotation[2]) > epsilon ||
-             fabs(localRotation[3] - baseRotation[3]) > epsilon);
-        hasScale |=
-            (fabs(localScale[0] - baseScaling[0]) > epsilon ||
-             fabs(localScale[1] - baseScaling[1]) > epsilon ||
-             fabs(localScale[2] - baseScaling[2]) > epsilon);
-
-        channel.translations.push_back(toVec3f(localTranslation) * scaleFactor);
-        channel.rotations.push_back(toQuatf(localRotation));
-        channel.scales.push_back(toVec3f(localScale));
-      }
+        for (size_t channelIx = 0; channelIx < blendShapes.GetChannelCount(); channelIx++) {
+          FbxAnimCurve* curve = nodeAnimation.shapeAnimCurves[channelIx];
+          float influence = (curve != nullptr) ? curve->Evaluate(pTime) : 0; // 0-100
+
+          int targetCount = static_cast<int>(blendShapes.GetTargetShapeCount(channelIx));
 
-      std::vector<FbxAnimCurve*> shapeAnimCurves;
-      FbxNodeAttribute* nodeAttr = pNode->GetNodeAttribute();
-      if (nodeAttr != nullptr && nodeAttr->GetAttributeType() == FbxNodeAttribute::EType::eMesh) {
-        // it's inelegant to recreate this same access class multiple times, but it's also dirt
-        // cheap...
-        FbxBlendShapesAccess blendShapes(static_cast<FbxMesh*>(nodeAttr));
-
-        for (FbxLongLong frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex; frameIndex++) {
-          FbxTime pTime;
-          pTime.SetFrame(frameIndex, eMode);
-
-          for (size_t channelIx = 0; channelIx < blendShapes.GetChannelCount(); channelIx++) {
-            FbxAnimCurve* curve = blendShapes.GetAnimation(channelIx, animIx);
-            float influence = (curve != nullptr) ? curve->Evaluate(pTime) : 0; // 0-100
-
-            int targetCount = static_cast<int>(blendShapes.GetTargetShapeCount(channelIx));
-
-            // the target shape 'fullWeight' values are a strictly ascending list of floats (between
-            // 0 and 100), forming a sequence of intervals -- this convenience function figures out
-            // if 'p' lays between some certain target fullWeights, and if so where (from 0 to 1).
-            auto findInInterval = [&](const double p, const int n) {
-              if (n >= targetCount) {
-                // p is certainly completely left of this interval
+          // the target shape 'fullWeight' values are a strictly ascending list of floats (between
+          // 0 and 100), forming a sequence of intervals -- this convenience function figures out
+          // if 'p' lays between some certain target fullWeights, and if so where (from 0 to 1).
+          auto findInInterval = [&](const double p, const int n) {
+            if (n >= targetCount) {
+              // p is certainly completely left of this interval
+              return NAN;
+            }
+            double leftWeight = 0;
+            if (n >= 0) {
+              leftWeight = blendShapes.GetTargetShape(channelIx, n).fullWeight;
+              if (p < leftWeight) {
                 return NAN;
               }
-              double leftWeight = 0;
-              if (n >= 0) {
-                leftWeight = blendShapes.GetTargetShape(channelIx, n).fullWeight;
-                if (p < leftWeight) {
-                  return NAN;
-                }
-                // the first interval implicitly includes all lesser influence values
-              }
-              double rightWeight = blendShapes.GetTargetShape(channelIx, n + 1).fullWeight;
-              if (p > rightWeight && n + 1 < targetCount - 1) {
-                return NAN;
-                // the last interval implicitly includes all greater influence values
+              // the first interval implicitly includes all lesser influence values
+            }
+            double rightWeight = blendShapes.GetTargetShape(channelIx, n + 1).fullWeight;
+            if (p > rightWeight && n + 1 < targetCount - 1) {
+              return NAN;
+              // the last interval implicitly includes all greater influence values
+            }
+            // transform p linearly such that [leftWeight, rightWeight] => [0, 1]
+            return static_cast<float>((p - leftWeight) / (rightWeight - leftWeight));
+          };
+
+          for (int targetIx = 0; targetIx < targetCount; targetIx++) {
+            if (curve) {
+              float result = findInInterval(influence, targetIx - 1);
+              if (!std::isnan(result)) {
+                // we're transitioning into targetIx
+                channel.weights.push_back(result);
+                hasMorphs = true;
+                continue;
               }
-              // transform p linearly such that [leftWeight, rightWeight] => [0, 1]
-              return static_cast<float>((p - leftWeight) / (rightWeight - leftWeight));
-            };
-
-            for (int targetIx = 0; targetIx < targetCount; targetIx++) {
-              if (curve) {
-                float result = findInInterval(influence, targetIx - 1);
+              if (targetIx != targetCount - 1) {
+                result = findInInterval(influence, targetIx);
                 if (!std::isnan(result)) {
-                  // we're transitioning into targetIx
-                  channel.weights.push_back(result);
+                  // we're transitioning AWAY from targetIx
+                  channel.weights.push_back(1.0f - result);
                   hasMorphs = true;
                   continue;
                 }
-                if (targetIx != targetCount - 1) {
-                  result = findInInterval(influence, targetIx);
-                  if (!std::isnan(result)) {
-                    // we're transitioning AWAY from targetIx
-                    channel.weights.push_back(1.0f - result);
-                    hasMorphs = true;
-                    continue;
-                  }
-                }
               }
-
-              // this is here because we have to fill in a weight for every channelIx/targetIx
-              // permutation, regardless of whether or not they participate in this animation.
-              channel.weights.push_back(0.0f);
             }
+
+            // this is here because we have to fill in a weight for every channelIx/targetIx
+            // permutation, regardless of whether or not they participate in this animation.
+            channel.weights.push_back(0.0f);
           }
         }
       }
+    }
 
-      if (hasTranslation || hasRotation || hasScale || hasMorphs) {
-        if (!hasTranslation) {
-          channel.translations.clear();
-        }
-        if (!hasRotation) {
-          channel.rotations.clear();
-        }
-        if (!hasScale) {
-          channel.scales.clear();
-        }
-        if (!hasMorphs) {
-          channel.weights.clear();
-        }
-
-        animation.channels.emplace_back(channel);
-
-        totalSizeInBytes += channel.translations.size() * sizeof(channel.translations[0]) +
-            channel.rotations.size() * sizeof(channel.rotations[0]) +
-            channel.scales.size() * sizeof(channel.scales[0]) +
-            channel.weights.size() * sizeof(channel.weights[0]);
+    if (hasTranslation || hasRotation || hasScale || hasMorphs) {
+      if (!hasTranslation) {
+        channel.translations.clear();
       }
-
-      if (verboseOutput) {
-        fmt::printf(
-            "\ranimation %d: %s (%d%%)",
-            animIx,
-            (const char*)animStackName,
-            nodeIndex * 100 / nodeCount);
+      if (!hasRotation) {
+        channel.rotations.clear();
+      }
+      if (!hasScale) {
+        channel.scales.clear();
+      }
+      if (!hasMorphs) {
+        channel.weights.clear();
       }
+      if (options.keyReduction.enabled) {
+        ReduceChannelKeys(channel, animation.times, options.keyReduction);
+      }
+
+      animation.channels.emplace_back(channel);
+
+      totalSizeInBytes += channel.translations.size() * sizeof(channel.translations[0]) +
+          channel.rotations.size() * sizeof(channel.rotations[0]) +
+          channel.scales.size() * sizeof(channel.scales[0]) +
+          channel.weights.size() * sizeof(channel.weights[0]);
     }
+  }
 
-    raw.AddAnimation(animation);
+  if (verboseOutput) {
+    fmt::printf(
+        "\ranimation %d: %s (%d channels, %3.1f MB)\n",
+        animIx,
+        (const char*)animStackName,
+        (int)animation.channels.size(),
+        (float)totalSizeInBytes * 1e-6f);
+  }
 
+  if (options.animationNativeKeys) {
+    fmt::printf(
+        "Animation %s: %zu nodes with native keys, %zu baked.\n",
+        std::string(animStackName),
+        nativeChannelCount,
+        animation.channels.size() - nativeChannelCount);
+  }
+
+  return animation;
+}
+
+static FbxManager* CreateFbxManager(const GltfOptions& options) {
+  FbxManager* pManager = FbxManager::Create();
+
+  if (!options.fbxTempDir.empty()) {
+    pManager->GetXRefManager().AddXRefProject("embeddedFileProject", options.fbxTempDir.c_str());
+    FbxXRefManager::sEmbeddedFileProject = "embeddedFileProject";
+    pManager->GetXRefManager().AddXRefProject("configurationProject", options.fbxTempDir.c_str());
+    FbxXRefManager::sConfigurationProject = "configurationProject";
+    pManager->GetXRefManager().AddXRefProject("localizationProject", options.fbxTempDir.c_str());
+    FbxXRefManager::sLocalizationProject = "localizationProject";
+    pManager->GetXRefManager().AddXRefProject("temporaryFileProject", options.fbxTempDir.c_str());
+    FbxXRefManager::sTemporaryFileProject = "temporaryFileProject";
+  }
+
+  FbxIOSettings* pIoSettings = FbxIOSettings::Create(pManager, IOSROOT);
+  pManager->SetIOSettings(pIoSettings);
+
+  return pManager;
+}
+
+static FbxScene* ImportFbxScene(FbxManager* pManager, const std::string& fbxFileNameU8) {
+  FbxImporter* pImporter = FbxImporter::Create(pManager, "");
+
+  if (!pImporter->Initialize(fbxFileNameU8.c_str(), -1, pManager->GetIOSettings())) {
     if (verboseOutput) {
-      fmt::printf(
-          "\ranimation %d: %s (%d channels, %3.1f MB)\n",
-          animIx,
-          (const char*)animStackName,
-          (int)animation.channels.size(),
-          (float)totalSizeInBytes * 1e-6f);
+      fmt::printf("%s\n", pImporter->GetStatus().GetErrorString());
     }
+    pImporter->Destroy();
+    return nullptr;
+  }
+
+  FbxScene* pScene = FbxScene::Create(pManager, "fbxScene");
+  pImporter->Import(pScene);
+  pImporter->Destroy();
+
+  return pScene;
+}
+
+static void ConvertFbxScene(FbxScene* pScene) {
+  // Use Y up for glTF
+  FbxAxisSystem::MayaYUp.ConvertScene(pScene);
+
+  // FBX's internal unscaled unit is centimetres, and if you choose not to work in that unit,
+  // you will find scaling transforms on all the children of the root node. Those transforms are
+  // superfluous and cause a lot of people a lot of trouble. Luckily we can get rid of them by
+  // converting to CM here (which just gets rid of the scaling), and then we pre-multiply the
+  // scale factor into every vertex position (and related attributes) instead.
+  FbxSystemUnit sceneSystemUnit = pScene->GetGlobalSettings().GetSystemUnit();
+  if (sceneSystemUnit != FbxSystemUnit::cm) {
+    FbxSystemUnit::cm.ConvertScene(pScene);
+  }
+}
+
+static void ReadAnimations(
+    RawModel& raw,
+    FbxScene* pScene,
+    const std::string& fbxFileNameU8,
+    const GltfOptions& options) {
+  const int animationCount = pScene->GetSrcObjectCount<FbxAnimStack>();
+  std::vector<int> rawNodeIndices(pScene->GetNodeCount());
+  for (int nodeIndex = 0; nodeIndex < pScene->GetNodeCount(); nodeIndex++) {
+    rawNodeIndices[nodeIndex] = raw.GetNodeById(pScene->GetNode(nodeIndex)->GetUniqueID());
+  }
+
+  std::vector<RawAnimation> animations(animationCount);
+  const int workerCount = options.parallelAnimations
+      ? static_cast<int>(std::min((unsigned)animationCount, ThreadUtils::GetThreadCount()))
+      : 1;
+  if (workerCount <= 1) {
+    for (int animIx = 0; animIx < animationCount; animIx++) {
+      animations[animIx] = ReadAnimation(pScene, animIx, rawNodeIndices, options, verboseOutput);
+    }
+  } else {
+    // The SDK evaluates animation through state kept in the scene, so each worker bakes from a
+    // scene of its own, imported anew from the same file; we keep the one we have. Imports take
+    // turns, as the SDK isn't safe to drive from several threads at once.
+    std::mutex importMutex;
+    std::atomic<int> nextAnimIx(0);
+    const auto worker = [&](FbxScene* pWorkerScene) {
+      FbxManager* pWorkerManager = nullptr;
+      if (pWorkerScene == nullptr) {
+        std::lock_guard<std::mutex> lock(importMutex);
+        pWorkerManager = CreateFbxManager(options);
+        pWorkerScene = ImportFbxScene(pWorkerManager, fbxFileNameU8);
+        if (pWorkerScene == nullptr) {
+          // leave the stacks to the other workers
+          pWorkerManager->Destroy();
+          return;
+        }
+        ConvertFbxScene(pWorkerScene);
+      }
+      for (int animIx = nextAnimIx++; animIx < animationCount; animIx = nextAnimIx++) {
+        animations[animIx] = ReadAnimation(pWorkerScene, animIx, rawNodeIndices, options, false);
+      }
+      if (pWorkerManager != nullptr) {
+        std::lock_guard<std::mutex> lock(importMutex);
+        pWorkerScene->Destroy();
+        pWorkerManager->Destroy();
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workerCount; i++) {
+      threads.emplace_back(worker, nullptr);
+    }
+    worker(pScene);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // add the animations in stack order, whichever worker baked them
+  for (const RawAnimation& animation : animations) {
+    raw.AddAnimation(animation);
   }
 }
 
@@ -1102,39 +1672,10 @@ bool LoadFBXFile(
     const std::set<std::string>& textureExtensions,
     const GltfOptions& options) {
   std::string fbxFileNameU8 = NativeToUTF8(fbxFileName);
-  FbxManager* pManager = FbxManager::Create();
-
-  if (!options.fbxTempDir.empty()) {
-    pManager->GetXRefManager().AddXRefProject("embeddedFileProject", options.fbxTempDir.c_str());
-    FbxXRefManager::sEmbeddedFileProject = "embeddedFileProject";
-    pManager->GetXRefManager().AddXRefProject("configurationProject", options.fbxTempDir.c_str());
-    FbxXRefManager::sConfigurationProject = "configurationProject";
-    pManager->GetXRefManager().AddXRefProject("localizationProject", options.fbxTempDir.c_str());
-    FbxXRefManager::sLocalizationProject = "localizationProject";
-    pManager->GetXRefManager().AddXRefProject("temporaryFileProject", options.fbxTempDir.c_str());
-    FbxXRefManager::sTemporaryFileProject = "temporaryFileProject";
-  }
-
-  FbxIOSettings* pIoSettings = FbxIOSettings::Create(pManager, IOSROOT);
-  pManager->SetIOSettings(pIoSettings);
-
-  FbxImporter* pImporter = FbxImporter::Create(pManager, "");
-
-  if (!pImporter->Initialize(fbxFileNameU8.c_str(), -1, pManager->GetIOSettings())) {
-    if (verboseOutput) {
-      fmt::printf("%s\n", pImporter->GetStatus().GetErrorString());
-    }
-    pImporter->Destroy();
-    pManager->Destroy();
-    return false;
-  }
-
-  FbxScene* pScene = FbxScene::Create(pManager, "fbxScene");
-  pImporter->Import(pScene);
-  pImporter->Destroy();
+  FbxManager* pManager = CreateFbxManager(options);
 
+  FbxScene* pScene = ImportFbxScene(pManager, fbxFileNameU8);
   if (pScene == nullptr) {
-    pImporter->Destroy();
     pManager->Destroy();
     return false;
   }
@@ -1142,28 +1683,20 @@ bool LoadFBXFile(
   std::map<const FbxTexture*, FbxString> textureLocations;
   FindFbxTextures(pScene, fbxFileName, textureExtensions, textureLocations);
 
-  // Use Y up for glTF
-  FbxAxisSystem::MayaYUp.ConvertScene(pScene);
-
-  // FBX's internal unscaled unit is centimetres, and if you choose not to work in that unit,
-  // you will find scaling transforms on all the children of the root node. Those transforms are
-  // superfluous and cause a lot of people a lot of trouble. Luckily we can get rid of them by
-  // converting to CM here (which just gets rid of the scaling), and then we pre-multiply the
-  // scale factor into every vertex position (and related attributes) instead.
-  FbxSystemUnit sceneSystemUnit = pScene->GetGlobalSettings().GetSystemUnit();
-  if (sceneSystemUnit != FbxSystemUnit::cm) {
-    FbxSystemUnit::cm.ConvertScene(pScene);
-  }
+  ConvertFbxScene(pScene);
   // this is always 0.01, but let's opt for clarity.
   scaleFactor = FbxSystemUnit::m.GetConversionFactorFrom(FbxSystemUnit::cm);
 
   ReadNodeHierarchy(raw, pScene, pScene->GetRootNode(), 0, "");
   ReadNodeAttributes(raw, pScene, pScene->GetRootNode(), textureLocations);
-  ReadAnimations(raw, pScene, options);
+  ReadAnimations(raw, pScene, fbxFileNameU8, options);
 
   pScene->Destroy();
   pManager->Destroy();
 
+  if (!options.uvTransform.IsIdentity()) {
+    raw.TransformTextures(options.uvTransform);
+  }
   return true;
 }
 
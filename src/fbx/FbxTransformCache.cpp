@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fbx/FbxTransformCache.hpp>
+
+FbxTransformCache::FbxTransformCache(const std::vector<FbxNode*>& nodes) {
+  for (FbxNode* pNode : nodes) {
+    AddNode(pNode);
+  }
+  globalTransforms.resize(this->nodes.size());
+  inverseGlobalTransforms.resize(this->nodes.size());
+}
+
+int FbxTransformCache::AddNode(FbxNode* pNode) {
+  const auto it = nodeIndices.find(pNode);
+  if (it != nodeIndices.end()) {
+    return it->second;
+  }
+  // ancestors go first, so each evaluation can walk the nodes in order
+  const int parentIndex = (pNode->GetParent() != nullptr) ? AddNode(pNode->GetParent()) : -1;
+  if (parentIndex >= 0) {
+    isParent[parentIndex] = true;
+  }
+  const int nodeIndex = static_cast<int>(nodes.size());
+  nodes.push_back(pNode);
+  parentIndices.push_back(parentIndex);
+  isParent.push_back(false);
+  nodeIndices.emplace(pNode, nodeIndex);
+  return nodeIndex;
+}
+
+void FbxTransformCache::Evaluate(const FbxTime& time) {
+  for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++) {
+    globalTransforms[nodeIndex] = nodes[nodeIndex]->EvaluateGlobalTransform(time);
+    if (isParent[nodeIndex]) {
+      inverseGlobalTransforms[nodeIndex] = globalTransforms[nodeIndex].Inverse();
+    }
+  }
+}
+
+FbxAMatrix FbxTransformCache::GetLocalTransform(const FbxNode* pNode) const {
+  const int nodeIndex = nodeIndices.at(pNode);
+  const int parentIndex = parentIndices[nodeIndex];
+  if (parentIndex < 0) {
+    return globalTransforms[nodeIndex];
+  }
+  // this is how the SDK derives a local transform, too
+  return inverseGlobalTransforms[parentIndex] * globalTransforms[nodeIndex];
+}
@@ -8,6 +8,8 @@
 
 #include <gltf/GltfModel.hpp>
 
+#include <meshoptimizer.h>
+
 std::shared_ptr<BufferViewData> GltfModel::GetAlignedBufferView(
     BufferData& buffer,
     const BufferViewData::GL_ArrayType target) {
@@ -63,6 +65,206 @@ std::shared_ptr<BufferViewData> GltfModel::AddBufferViewForFile(
   return result;
 }
 
+static const char* DescribeFilter(const MeshoptFilter filter) {
+  switch (filter) {
+    case MeshoptFilter::OCTAHEDRAL:
+      return "OCTAHEDRAL";
+    case MeshoptFilter::QUATERNION:
+      return "QUATERNION";
+    case MeshoptFilter::EXPONENTIAL:
+      return "EXPONENTIAL";
+    default:
+      return "NONE";
+  }
+}
+
+std::shared_ptr<AccessorData> GltfModel::AddFilteredAccessorWithView(
+    BufferViewData& bufferView,
+    const GLType& type,
+    const std::vector<float>& source,
+    const std::string& name,
+    const MeshoptFilter filter) {
+  // OCTAHEDRAL and QUATERNION decode to four normalized shorts, EXPONENTIAL to the same floats
+  const bool toShorts = (filter != MeshoptFilter::EXPONENTIAL);
+  auto accessor = accessors.hold(new AccessorData(
+      bufferView, toShorts ? GLType(CT_SHORT, type.count, type.dataType) : type, name));
+  accessor->count = AppendFiltered(bufferView, type, source, filter);
+  accessor->normalized = toShorts;
+  return accessor;
+}
+
+uint32_t GltfModel::AppendFiltered(
+    BufferViewData& bufferView,
+    const GLType& type,
+    const std::vector<float>& source,
+    const MeshoptFilter filter) {
+  const bool toShorts = (filter != MeshoptFilter::EXPONENTIAL);
+  const uint32_t components = toShorts ? 4 : type.count;
+  const uint32_t count = to_uint32(source.size() / components);
+  const uint32_t byteStride = toShorts ? 8 : type.byteStride();
+
+  const size_t offset = binary->size();
+  binary->resize(offset + (size_t)count * byteStride);
+  uint8_t* destination = &(*binary)[offset];
+  switch (filter) {
+    case MeshoptFilter::OCTAHEDRAL:
+      meshopt_encodeFilterOct(
+          destination, count, byteStride, meshopt.bitsForNormals, source.data());
+      break;
+    case MeshoptFilter::QUATERNION:
+      meshopt_encodeFilterQuat(
+          destination, count, byteStride, meshopt.bitsForRotations, source.data());
+      break;
+    default:
+      meshopt_encodeFilterExp(
+          destination,
+          count,
+          byteStride,
+          meshopt.bitsForDeltas,
+          source.data(),
+          meshopt_EncodeExpSeparate);
+      break;
+  }
+
+  bufferView.byteLength = count * byteStride;
+  if (toShorts && bufferView.target == BufferViewData::GL_ARRAY_BUFFER && type.count != 4) {
+    // e.g. a VEC3 normal stored in the four shorts the filter decodes to
+    bufferView.byteStride = byteStride;
+  }
+  CompressBufferView(bufferView, count, byteStride, filter);
+  return count;
+}
+
+std::shared_ptr<AccessorData> GltfModel::AddEncodedAccessorWithView(
+    BufferViewData& bufferView,
+    const GLType& type,
+    const std::vector<uint8_t>& source,
+    const uint32_t byteStride,
+    const bool normalized,
+    const std::string& name) {
+  const uint32_t count = to_uint32(source.size() / byteStride);
+  binary->insert(binary->end(), source.begin(), source.end());
+
+  auto accessor = accessors.hold(new AccessorData(bufferView, type, name));
+  accessor->count = count;
+  accessor->normalized = normalized;
+  bufferView.byteLength = count * byteStride;
+  if (bufferView.target == BufferViewData::GL_ARRAY_BUFFER && type.byteStride() != byteStride) {
+    bufferView.byteStride = byteStride;
+  }
+  if (meshopt.enabled) {
+    CompressBufferView(bufferView, count, byteStride, MeshoptFilter::NONE);
+  }
+  return accessor;
+}
+
+std::shared_ptr<AccessorData> GltfModel::AddEncodedSparseAccessor(
+    BufferData& buffer,
+    const GLType& type,
+    const uint32_t count,
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint8_t>& values,
+    const bool normalized,
+    const std::string& name) {
+  auto accessor = accessors.hold(new AccessorData(type));
+  accessor->count = count;
+  accessor->normalized = normalized;
+  accessor->name = name;
+  if (indices.empty()) {
+    return accessor;
+  }
+
+  AddSparseIndices(buffer, *accessor, indices);
+  auto valueView = GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_NONE);
+  binary->insert(binary->end(), values.begin(), values.end());
+  valueView->byteLength = to_uint32(values.size());
+  if (meshopt.enabled) {
+    CompressBufferView(
+        *valueView, to_uint32(indices.size()), type.byteStride(), MeshoptFilter::NONE);
+  }
+  accessor->sparseValuesBufferView = valueView->ix;
+  return accessor;
+}
+
+void GltfModel::AddSparseIndices(
+    BufferData& buffer,
+    AccessorData& accessor,
+    const std::vector<uint32_t>& indices) {
+  const GLType& indexType = (accessor.count <= 0x10000) ? GLT_USHORT : GLT_UINT;
+  auto indexView = GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_NONE);
+  AppendElements(*indexView, indexType, indices);
+
+  accessor.sparseCount = to_uint32(indices.size());
+  accessor.sparseIndicesBufferView = indexView->ix;
+  accessor.sparseIndicesComponentType = indexType.componentType.glType;
+}
+
+void GltfModel::CompressBufferView(
+    BufferViewData& bufferView,
+    const uint32_t count,
+    const uint32_t byteStride,
+    const MeshoptFilter filter) {
+  assert(bufferView.byteOffset + bufferView.byteLength == binary->size());
+  const uint8_t* data = &(*binary)[bufferView.byteOffset];
+  if (count == 0) {
+    return;
+  }
+
+  // the extension requires version 0 of the vertex codec and version 1 of the index codec
+  meshopt_encodeVertexVersion(0);
+  meshopt_encodeIndexVersion(1);
+
+  std::vector<uint8_t> compressed;
+  std::string mode;
+  if (bufferView.target == BufferViewData::GL_ELEMENT_ARRAY_BUFFER) {
+    if ((count % 3) != 0 || (byteStride != 2 && byteStride != 4)) {
+      return;
+    }
+    std::vector<unsigned int> indices(count);
+    unsigned int vertexCount = 0;
+    for (uint32_t ii = 0; ii < count; ii++) {
+      indices[ii] = (byteStride == 2) ? ((const uint16_t*)data)[ii] : ((const uint32_t*)data)[ii];
+      vertexCount = std::max(vertexCount, indices[ii] + 1);
+    }
+    compressed.resize(meshopt_encodeIndexBufferBound(count, vertexCount));
+    compressed.resize(
+        meshopt_encodeIndexBuffer(compressed.data(), compressed.size(), indices.data(), count));
+    mode = "TRIANGLES";
+  } else {
+    if ((byteStride % 4) != 0 || byteStride > 256) {
+      return;
+    }
+    compressed.resize(meshopt_encodeVertexBufferBound(count, byteStride));
+    compressed.resize(meshopt_encodeVertexBuffer(
+        compressed.data(), compressed.size(), data, count, byteStride));
+    mode = "ATTRIBUTES";
+  }
+  if (compressed.empty()) {
+    return;
+  }
+
+  // the view moves into the fallback buffer, and the compressed bytes replace its data
+  if (meshoptFallbackBuffer == nullptr) {
+    meshoptFallbackBuffer = buffers.hold(new BufferData());
+  }
+  uint32_t fallbackOffset = meshoptFallbackBuffer->fallbackByteLength;
+  if ((fallbackOffset % 4) > 0) {
+    fallbackOffset += (4 - (fallbackOffset % 4));
+  }
+  meshoptFallbackBuffer->fallbackByteLength = fallbackOffset + bufferView.byteLength;
+
+  bufferView.fallbackBuffer = meshoptFallbackBuffer->ix;
+  bufferView.fallbackByteOffset = fallbackOffset;
+  bufferView.compressedByteLength = to_uint32(compressed.size());
+  bufferView.compressedByteStride = byteStride;
+  bufferView.compressedCount = count;
+  bufferView.compressionMode = mode;
+  bufferView.compressionFilter = DescribeFilter(filter);
+
+  binary->resize(bufferView.byteOffset);
+  binary->insert(binary->end(), compressed.begin(), compressed.end());
+}
+
 void GltfModel::serializeHolders(json& glTFJson) {
   serializeHolder(glTFJson, "buffers", buffers);
   serializeHolder(glTFJson, "bufferViews", bufferViews);
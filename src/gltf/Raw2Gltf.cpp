@@ -22,7 +22,10 @@
 #include <stb_image_write.h>
 
 #include <utils/File_Utils.hpp>
+#include <utils/Thread_Utils.hpp>
 
+#include "raw/PrimitiveOptimizer.hpp"
+#include "raw/PrimitiveSimplifier.hpp"
 #include "raw/RawModel.hpp"
 
 #include <gltf/properties/AccessorData.hpp>
@@ -45,6 +48,70 @@ typedef uint32_t TriangleIndex;
 
 #define DEFAULT_SCENE_NAME "Root Scene"
 
+// The MSFT_screencoverage hint of a mesh at full detail; lower levels of detail get the fraction of
+// it that they keep of the triangles, for about the same triangle density on screen.
+const float LOD_FULL_DETAIL_SCREEN_COVERAGE = 0.5f;
+
+// Morph target attributes are written sparsely when fewer than this fraction of vertices move.
+const float MORPH_TARGET_SPARSE_FRACTION = 0.5f;
+
+// Writes a morph target attribute from the deltas of just the vertices that move, given by their
+// local indices: as a sparse accessor if few enough do, otherwise densely, zeros included.
+template <class T>
+static std::shared_ptr<AccessorData> AddMorphTargetAccessor(
+    GltfModel& gltf,
+    BufferData& buffer,
+    const GLType& type,
+    const uint32_t vertexCount,
+    const std::vector<uint32_t>& indices,
+    const std::vector<T>& deltas,
+    const std::string& name,
+    const MeshoptFilter filter) {
+  if (indices.size() < vertexCount * MORPH_TARGET_SPARSE_FRACTION) {
+    return gltf.AddSparseAccessor(buffer, type, vertexCount, indices, deltas, name, filter);
+  }
+  std::vector<T> dense(vertexCount, T(0.0f));
+  for (size_t ii = 0; ii < indices.size(); ii++) {
+    dense[indices[ii]] = deltas[ii];
+  }
+  return gltf.AddAccessorWithView(
+      *gltf.GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER),
+      type,
+      dense,
+      name,
+      filter);
+}
+
+// As AddMorphTargetAccessor(), for deltas already encoded as the type and tightly packed; dense
+// ones are padded to keep each vertex four-byte aligned.
+static std::shared_ptr<AccessorData> AddEncodedMorphTargetAccessor(
+    GltfModel& gltf,
+    BufferData& buffer,
+    const GLType& type,
+    const uint32_t vertexCount,
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint8_t>& deltas,
+    const bool normalized,
+    const std::string& name) {
+  if (indices.size() < vertexCount * MORPH_TARGET_SPARSE_FRACTION) {
+    return gltf.AddEncodedSparseAccessor(
+        buffer, type, vertexCount, indices, deltas, normalized, name);
+  }
+  const uint32_t elementSize = type.byteStride();
+  const uint32_t byteStride = (elementSize + 3) & ~3u;
+  std::vector<uint8_t> dense((size_t)vertexCount * byteStride, 0);
+  for (size_t ii = 0; ii < indices.size(); ii++) {
+    memcpy(&dense[(size_t)indices[ii] * byteStride], &deltas[ii * elementSize], elementSize);
+  }
+  return gltf.AddEncodedAccessorWithView(
+      *gltf.GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER),
+      type,
+      dense,
+      byteStride,
+      normalized,
+      name);
+}
+
 /**
  * This method sanity-checks existance and then returns a *reference* to the *Data instance
  * registered under that name. This is safe in the context of this tool, where all such data
@@ -66,17 +133,130 @@ T& require(std::map<long, std::shared_ptr<T>> map, long key) {
   return result;
 }
 
-static const std::vector<TriangleIndex> getIndexArray(const RawModel& raw) {
-  std::vector<TriangleIndex> result;
+static const std::vector<TriangleIndex> getIndexArray(const RawPrimitive& rawPrimitive) {
+  return std::vector<TriangleIndex>(rawPrimitive.indices.begin(), rawPrimitive.indices.end());
+}
+
+// a mesh's quantized positions are dequantized as offset + scale * position, uniformly on all axes
+struct PositionQuantization {
+  Vec3f offset;
+  float scale;
+};
+
+// a material's quantized texture coordinates are remapped as offset + scale * uv, if enabled
+struct TexCoordQuantization {
+  bool enabled = false;
+  bool initialized = false;
+  Vec2f min;
+  Vec2f max;
+  Vec2f offset{0.0f, 0.0f};
+  Vec2f scale{1.0f, 1.0f};
+};
+
+static std::vector<uint8_t> QuantizePositions(
+    const std::vector<Vec3f>& positions,
+    const PositionQuantization& quantization,
+    Boundsf& quantizedBounds) {
+  // three shorts, padded to keep each vertex four-byte aligned
+  std::vector<uint8_t> result(positions.size() * 8, 0);
+  for (size_t ii = 0; ii < positions.size(); ii++) {
+    const Vec3f scaled = (positions[ii] - quantization.offset) / quantization.scale;
+    int16_t* quantized = (int16_t*)&result[ii * 8];
+    for (int jj = 0; jj < 3; jj++) {
+      quantized[jj] = (int16_t)glm::clamp(std::round(scaled[jj]), -32767.0f, 32767.0f);
+    }
+    quantizedBounds.AddPoint(Vec3f(quantized[0], quantized[1], quantized[2]));
+  }
+  return result;
+}
+
+template <class T>
+static std::vector<uint8_t> QuantizeUnitVectors(const std::vector<T>& vectors, const int bits) {
+  // normalized bytes, rounded to the requested precision first; VEC3 is padded to four bytes
+  const float maxValue = (float)((1 << (bits - 1)) - 1);
+  std::vector<uint8_t> result(vectors.size() * 4, 0);
+  for (size_t ii = 0; ii < vectors.size(); ii++) {
+    int8_t* quantized = (int8_t*)&result[ii * 4];
+    for (int jj = 0; jj < T::length(); jj++) {
+      const float value = std::round(glm::clamp(vectors[ii][jj], -1.0f, 1.0f) * maxValue);
+      quantized[jj] = (int8_t)std::round(value * 127.0f / maxValue);
+    }
+  }
+  return result;
+}
+
+static std::vector<uint8_t> QuantizeTexCoords(
+    const std::vector<Vec2f>& texCoords,
+    const TexCoordQuantization& quantization,
+    const int bits) {
+  // normalized unsigned shorts, rounded to the requested precision first
+  const float maxValue = (float)((1 << bits) - 1);
+  std::vector<uint8_t> result(texCoords.size() * 4, 0);
+  for (size_t ii = 0; ii < texCoords.size(); ii++) {
+    const Vec2f unit = (texCoords[ii] - quantization.offset) / quantization.scale;
+    uint16_t* quantized = (uint16_t*)&result[ii * 4];
+    for (int jj = 0; jj < 2; jj++) {
+      const float value = std::round(glm::clamp(unit[jj], 0.0f, 1.0f) * maxValue);
+      quantized[jj] = (uint16_t)std::round(value * 65535.0f / maxValue);
+    }
+  }
+  return result;
+}
+
+static const char* DescribeInterpolation(const RawInterpolation interpolation) {
+  switch (interpolation) {
+    case RAW_INTERPOLATION_STEP:
+      return "STEP";
+    case RAW_INTERPOLATION_CUBICSPLINE:
+      return "CUBICSPLINE";
+    default:
+      return "LINEAR";
+  }
+}
 
-  for (int i = 0; i < raw.GetTriangleCount(); i++) {
-    result.push_back((TriangleIndex)raw.GetTriangle(i).verts[0]);
-    result.push_back((TriangleIndex)raw.GetTriangle(i).verts[1]);
-    result.push_back((TriangleIndex)raw.GetTriangle(i).verts[2]);
+// The narrowest signed integer component type that holds all of the bounds, if any does.
+static const ComponentType* IntegerComponentType(const Boundsf& bounds) {
+  float extreme = 0.0f;
+  for (int ii = 0; ii < 3; ii++) {
+    extreme = std::max(extreme, std::max(-bounds.min[ii], bounds.max[ii]));
+  }
+  if (extreme <= 127.0f) {
+    return &CT_BYTE;
+  }
+  return (extreme <= 32767.0f) ? &CT_SHORT : nullptr;
+}
+
+// Morph target deltas, already scaled to the range of the signed integer component type, tightly
+// packed as sparse accessors require.
+static std::vector<uint8_t> PackDeltas(
+    const std::vector<Vec3f>& deltas,
+    const ComponentType& componentType) {
+  const float maxValue = (componentType.size == 1) ? 127.0f : 32767.0f;
+  std::vector<uint8_t> result(deltas.size() * 3 * componentType.size, 0);
+  for (size_t ii = 0; ii < deltas.size(); ii++) {
+    for (int jj = 0; jj < 3; jj++) {
+      const float value = glm::clamp(std::round(deltas[ii][jj]), -maxValue, maxValue);
+      if (componentType.size == 1) {
+        ((int8_t*)result.data())[ii * 3 + jj] = (int8_t)value;
+      } else {
+        ((int16_t*)result.data())[ii * 3 + jj] = (int16_t)value;
+      }
+    }
   }
   return result;
 }
 
+static bool InUnitRange(const Vec2f& min, const Vec2f& max) {
+  return min.x >= 0.0f && min.y >= 0.0f && max.x <= 1.0f && max.y <= 1.0f;
+}
+
+static bool HasTextures(const MaterialData& material) {
+  const PBRMetallicRoughness* pbr = material.pbrMetallicRoughness.get();
+  return material.normalTexture != nullptr || material.occlusionTexture != nullptr ||
+      material.emissiveTexture != nullptr ||
+      (pbr != nullptr && (pbr->baseColorTexture != nullptr || pbr->metRoughTexture != nullptr));
+}
+
 ModelData* Raw2Gltf(
     std::ofstream& gltfOutStream,
     const std::string& outputFolder,
@@ -97,30 +277,177 @@ ModelData* Raw2Gltf(
     }
   }
 
-  std::vector<RawModel> materialModels;
-  raw.CreateMaterialModels(
-      materialModels,
+  std::vector<RawPrimitive> rawPrimitives;
+  raw.CreatePrimitives(
+      rawPrimitives,
       options.useLongIndices == UseLongIndicesOptions::NEVER,
       options.keepAttribs,
       true);
 
+  // the triangle count of each surface at full and each lower level of detail; zero for a level
+  // that was dropped because it simplified no further than the level before
+  std::map<int, std::vector<size_t>> lodTriangleCountsBySurface;
+  if (!options.lod.ratios.empty()) {
+    const size_t primitiveCount = rawPrimitives.size();
+    const size_t levelCount = options.lod.ratios.size();
+    std::vector<RawPrimitive> lodPrimitives(primitiveCount * levelCount);
+    ThreadUtils::ParallelFor(lodPrimitives.size(), 1, [&](const size_t begin, const size_t end) {
+      for (size_t lodIx = begin; lodIx < end; lodIx++) {
+        const RawPrimitive& rawPrimitive = rawPrimitives[lodIx % primitiveCount];
+        const size_t level = lodIx / primitiveCount;
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_POSITION) == 0) {
+          continue;
+        }
+        const float error = options.lod.errors.empty()
+            ? 0.01f
+            : options.lod.errors[std::min(level, options.lod.errors.size() - 1)];
+        lodPrimitives[lodIx] =
+            SimplifyPrimitive(raw, rawPrimitive, options.lod.ratios[level], error);
+        lodPrimitives[lodIx].lodLevel = (int)level + 1;
+      }
+    });
+
+    for (const auto& rawPrimitive : rawPrimitives) {
+      std::vector<size_t>& triangleCounts = lodTriangleCountsBySurface[rawPrimitive.surfaceIndex];
+      triangleCounts.resize(levelCount + 1, 0);
+      triangleCounts[0] += rawPrimitive.GetTriangleCount();
+    }
+    for (const auto& lodPrimitive : lodPrimitives) {
+      if (lodPrimitive.GetTriangleCount() > 0) {
+        lodTriangleCountsBySurface[lodPrimitive.surfaceIndex][lodPrimitive.lodLevel] +=
+            lodPrimitive.GetTriangleCount();
+      }
+    }
+    for (auto& entry : lodTriangleCountsBySurface) {
+      size_t previousCount = entry.second[0];
+      for (size_t level = 1; level <= levelCount; level++) {
+        if (entry.second[level] >= previousCount) {
+          entry.second[level] = 0;
+        } else if (entry.second[level] > 0) {
+          previousCount = entry.second[level];
+        }
+      }
+    }
+    // the levels follow the full-detail primitives, so the passes below handle them alike
+    for (auto& lodPrimitive : lodPrimitives) {
+      if (lodPrimitive.GetTriangleCount() > 0 &&
+          lodTriangleCountsBySurface[lodPrimitive.surfaceIndex][lodPrimitive.lodLevel] > 0) {
+        rawPrimitives.push_back(std::move(lodPrimitive));
+      }
+    }
+    if (verboseOutput) {
+      for (size_t level = 1; level <= levelCount; level++) {
+        size_t triangleCount = 0;
+        for (const auto& entry : lodTriangleCountsBySurface) {
+          triangleCount += entry.second[level];
+        }
+        fmt::printf("Level of detail %d: %lu triangles\n", (int)level, triangleCount);
+      }
+    }
+  }
+
+  if (options.optimizeVertexCache || options.optimizeOverdraw > 0.0f || options.buildMeshlets) {
+    size_t triangleCount = 0;
+    size_t missesBefore = 0;
+    for (const auto& rawPrimitive : rawPrimitives) {
+      triangleCount += rawPrimitive.GetTriangleCount();
+      missesBefore += verboseOutput ? CountVertexCacheMisses(rawPrimitive) : 0;
+    }
+    // only the triangles within each primitive move, and CreatePrimitives never puts opaque and
+    // transparent triangles in one primitive, so the primitives stay opaque before transparent;
+    // transparent ones are left out of the overdraw pass, whose order doesn't apply to blending
+    const bool hasPositions = (raw.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_POSITION) != 0;
+    const bool optimizeOverdraw = options.optimizeOverdraw > 0.0f && hasPositions;
+    const std::vector<Vec3f>& positions = raw.GetAttributeArray(&RawVertexStreams::position);
+    ThreadUtils::ParallelFor(rawPrimitives.size(), 1, [&](const size_t begin, const size_t end) {
+      for (size_t primIx = begin; primIx < end; primIx++) {
+        OptimizeVertexCache(rawPrimitives[primIx]);
+        if (optimizeOverdraw && !rawPrimitives[primIx].transparent) {
+          OptimizeOverdraw(rawPrimitives[primIx], positions, options.optimizeOverdraw);
+        }
+        // the vertices were numbered in first-use order of the sorted triangles; restore that
+        OptimizeVertexFetch(rawPrimitives[primIx]);
+        if (options.buildMeshlets && hasPositions) {
+          BuildMeshlets(rawPrimitives[primIx], positions);
+        }
+      }
+    });
+    if (verboseOutput && triangleCount > 0) {
+      size_t missesAfter = 0;
+      for (const auto& rawPrimitive : rawPrimitives) {
+        missesAfter += CountVertexCacheMisses(rawPrimitive);
+      }
+      fmt::printf(
+          "Vertex cache ACMR: %.3f -> %.3f\n",
+          (double)missesBefore / triangleCount,
+          (double)missesAfter / triangleCount);
+    }
+  }
+
   if (verboseOutput) {
     fmt::printf("%7d vertices\n", raw.GetVertexCount());
     fmt::printf("%7d triangles\n", raw.GetTriangleCount());
     fmt::printf("%7d textures\n", raw.GetTextureCount());
     fmt::printf("%7d nodes\n", raw.GetNodeCount());
-    fmt::printf("%7d surfaces\n", (int)materialModels.size());
+    fmt::printf("%7d surfaces\n", (int)rawPrimitives.size());
     fmt::printf("%7d animations\n", raw.GetAnimationCount());
     fmt::printf("%7d cameras\n", raw.GetCameraCount());
     fmt::printf("%7d lights\n", raw.GetLightCount());
   }
 
+  // KHR_mesh_quantization; Draco quantizes the geometry it compresses by itself
+  const bool quantize = options.quantize.enabled && !options.draco.enabled;
+  const bool quantizeNormals = quantize &&
+      !(options.meshopt.enabled && options.meshopt.normalFilter != MeshoptFilter::NONE);
+  std::map<long, PositionQuantization> positionQuantBySurfaceId;
+  std::vector<TexCoordQuantization> uvQuantByMaterial(raw.GetMaterialCount());
+  bool usesMeshQuantization = false;
+  bool usesTextureTransform = false;
+  if (quantize) {
+    std::map<long, Boundsf> boundsBySurfaceId;
+    for (const auto& rawPrimitive : rawPrimitives) {
+      const RawSurface& rawSurface = raw.GetSurface(rawPrimitive.surfaceIndex);
+      // morph weights are animated on the node holding the mesh, so a mesh with blend shapes can
+      // only move its dequantization into the inverse bind matrices of a skin
+      if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_POSITION) != 0 &&
+          (!rawSurface.jointIds.empty() || rawSurface.blendChannels.empty())) {
+        const auto& min = rawPrimitive.bounds.min;
+        const auto& max = rawPrimitive.bounds.max;
+        Boundsf& surfaceBounds = boundsBySurfaceId[rawSurface.id];
+        surfaceBounds.AddPoint(Vec3f(min[0], min[1], min[2]));
+        surfaceBounds.AddPoint(Vec3f(max[0], max[1], max[2]));
+      }
+      if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV0) != 0) {
+        std::vector<Vec2f> uvs;
+        raw.GetAttributeArray(uvs, &RawVertexStreams::uv0, rawPrimitive);
+        TexCoordQuantization& uvQuant = uvQuantByMaterial[rawPrimitive.materialIndex];
+        for (const Vec2f& uv : uvs) {
+          uvQuant.min = uvQuant.initialized ? glm::min(uvQuant.min, uv) : uv;
+          uvQuant.max = uvQuant.initialized ? glm::max(uvQuant.max, uv) : uv;
+          uvQuant.initialized = true;
+        }
+      }
+    }
+    const float maxPosition = (float)((1 << (options.quantize.quantBitsPosition - 1)) - 1);
+    for (const auto& entry : boundsBySurfaceId) {
+      const Vec3f min(entry.second.min[0], entry.second.min[1], entry.second.min[2]);
+      const Vec3f max(entry.second.max[0], entry.second.max[1], entry.second.max[2]);
+      const Vec3f halfExtent = (max - min) * 0.5f;
+      const float maxHalfExtent = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+      PositionQuantization& quantization = positionQuantBySurfaceId[entry.first];
+      quantization.offset = (min + max) * 0.5f;
+      quantization.scale = (maxHalfExtent > 0.0f) ? maxHalfExtent / maxPosition : 1.0f;
+    }
+  }
+
   std::unique_ptr<GltfModel> gltf(new GltfModel(options));
 
   std::map<long, std::shared_ptr<NodeData>> nodesById;
   std::map<long, std::shared_ptr<MaterialData>> materialsById;
   std::map<std::string, std::shared_ptr<TextureData>> textureByIndicesKey;
   std::map<long, std::shared_ptr<MeshData>> meshBySurfaceId;
+  std::vector<std::map<long, std::shared_ptr<MeshData>>> lodMeshesBySurfaceId(
+      options.lod.ratios.size());
 
   // for now, we only have one buffer; data->binary points to the same vector as that BufferData
   // does.
@@ -150,6 +477,54 @@ ModelData* Raw2Gltf(
       nodesById.insert(std::make_pair(node.id, nodeData));
     }
 
+    //
+    // nodes that hold a mesh on behalf of a node, and its levels of detail
+    //
+
+    std::map<long, std::shared_ptr<NodeData>> meshNodesById;
+    std::map<long, std::map<size_t, std::shared_ptr<NodeData>>> lodNodesById;
+    for (int i = 0; i < raw.GetNodeCount(); i++) {
+      const RawNode& node = raw.GetNode(i);
+      if (node.surfaceId <= 0) {
+        continue;
+      }
+      const int surfaceIndex = raw.GetSurfaceById(node.surfaceId);
+      const RawSurface& rawSurface = raw.GetSurface(surfaceIndex);
+      auto positionQuantIter = positionQuantBySurfaceId.find(rawSurface.id);
+      const bool dequantizeInNode = positionQuantIter != positionQuantBySurfaceId.end() &&
+          node.instances.empty() && rawSurface.jointIds.empty();
+      auto triangleCountsIter = lodTriangleCountsBySurface.find(surfaceIndex);
+      const size_t levelCount = (triangleCountsIter != lodTriangleCountsBySurface.end())
+          ? triangleCountsIter->second.size()
+          : 0;
+      bool hasLods = false;
+      for (size_t level = 1; level < levelCount; level++) {
+        hasLods |= triangleCountsIter->second[level] > 0;
+      }
+      if (!dequantizeInNode && !hasLods) {
+        continue;
+      }
+      // a childless child node holds the mesh: it dequantizes the positions with its transform,
+      // and MSFT_lod may swap it out without taking the children or animation of the node along;
+      // a skin ignores the transform anyway, and the morph weights are animated on this node
+      const Vec3f translation = dequantizeInNode ? positionQuantIter->second.offset : Vec3f(0.0f);
+      const Vec3f scale = dequantizeInNode ? Vec3f(positionQuantIter->second.scale) : Vec3f(1.0f);
+      auto meshNode = gltf->nodes.hold(
+          new NodeData(node.name, translation, Quatf(1.0f, 0.0f, 0.0f, 0.0f), scale, false));
+      gltf->nodes.ptrs[i]->AddChildNode(meshNode->ix);
+      meshNodesById[node.id] = meshNode;
+      for (size_t level = 1; level < levelCount; level++) {
+        if (triangleCountsIter->second[level] > 0) {
+          lodNodesById[node.id][level] = gltf->nodes.hold(new NodeData(
+              fmt::format("{}_LOD{}", node.name, level),
+              translation,
+              Quatf(1.0f, 0.0f, 0.0f, 0.0f),
+              scale,
+              false));
+        }
+      }
+    }
+
     //
     // animations
     //
@@ -163,11 +538,21 @@ ModelData* Raw2Gltf(
         continue;
       }
 
-      auto accessor = gltf->AddAccessorAndView(buffer, GLT_FLOAT, animation.times);
-      accessor->min = {*std::min_element(std::begin(animation.times), std::end(animation.times))};
-      accessor->max = {*std::max_element(std::begin(animation.times), std::end(animation.times))};
+      AnimationData& aDat = *gltf->animations.hold(new AnimationData(animation.name));
+      // properties keyed at the same times share an input accessor, whether the animation's or
+      // their own
+      std::map<std::vector<float>, std::shared_ptr<AccessorData>> timeAccessors;
+      const auto getTimeAccessor = [&](const RawKeyTiming& timing) -> const AccessorData& {
+        const std::vector<float>& times = timing.times.empty() ? animation.times : timing.times;
+        std::shared_ptr<AccessorData>& accessor = timeAccessors[times];
+        if (accessor == nullptr) {
+          accessor = gltf->AddAccessorAndView(buffer, GLT_FLOAT, times);
+          accessor->min = {*std::min_element(std::begin(times), std::end(times))};
+          accessor->max = {*std::max_element(std::begin(times), std::end(times))};
+        }
+        return *accessor;
+      };
 
-      AnimationData& aDat = *gltf->animations.hold(new AnimationData(animation.name, *accessor));
       if (verboseOutput) {
         fmt::printf(
             "Animation '%s' has %lu channels:\n",
@@ -194,22 +579,50 @@ ModelData* Raw2Gltf(
         if (!channel.translations.empty()) {
           aDat.AddNodeChannel(
               nDat,
-              *gltf->AddAccessorAndView(buffer, GLT_VEC3F, channel.translations),
-              "translation");
+              getTimeAccessor(channel.translationTiming),
+              *gltf->AddAccessorAndView(
+                  buffer, GLT_VEC3F, channel.translations, options.meshopt.deltaFilter),
+              "translation",
+              DescribeInterpolation(channel.translationTiming.interpolation));
         }
         if (!channel.rotations.empty()) {
           aDat.AddNodeChannel(
-              nDat, *gltf->AddAccessorAndView(buffer, GLT_QUATF, channel.rotations), "rotation");
+              nDat,
+              getTimeAccessor(channel.rotationTiming),
+              *gltf->AddAccessorAndView(
+                  buffer, GLT_QUATF, channel.rotations, options.meshopt.rotationFilter),
+              "rotation",
+              DescribeInterpolation(channel.rotationTiming.interpolation));
         }
         if (!channel.scales.empty()) {
           aDat.AddNodeChannel(
-              nDat, *gltf->AddAccessorAndView(buffer, GLT_VEC3F, channel.scales), "scale");
+              nDat,
+              getTimeAccessor(channel.scaleTiming),
+              *gltf->AddAccessorAndView(
+                  buffer, GLT_VEC3F, channel.scales, options.meshopt.deltaFilter),
+              "scale",
+              DescribeInterpolation(channel.scaleTiming.interpolation));
         }
         if (!channel.weights.empty()) {
-          aDat.AddNodeChannel(
-              nDat,
-              *gltf->AddAccessorAndView(buffer, {CT_FLOAT, 1, "SCALAR"}, channel.weights),
-              "weights");
+          // the weights go to the node holding the mesh, and each of its levels of detail
+          std::vector<const NodeData*> weightNodes{&nDat};
+          auto meshNodeIter = meshNodesById.find(node.id);
+          if (meshNodeIter != meshNodesById.end()) {
+            weightNodes = {meshNodeIter->second.get()};
+            for (const auto& entry : lodNodesById[node.id]) {
+              weightNodes.push_back(entry.second.get());
+            }
+          }
+          const auto& weights =
+              *gltf->AddAccessorAndView(buffer, {CT_FLOAT, 1, "SCALAR"}, channel.weights);
+          for (const NodeData* weightNode : weightNodes) {
+            aDat.AddNodeChannel(
+                *weightNode,
+                getTimeAccessor(channel.weightTiming),
+                weights,
+                "weights",
+                DescribeInterpolation(channel.weightTiming.interpolation));
+          }
         }
       }
     }
@@ -408,20 +821,38 @@ ModelData* Raw2Gltf(
       if (options.enableUserProperties) {
         mData->userProperties = material.userProperties;
       }
+
+      TexCoordQuantization& uvQuant = uvQuantByMaterial[materialIndex];
+      if (uvQuant.initialized) {
+        if (InUnitRange(uvQuant.min, uvQuant.max)) {
+          uvQuant.enabled = true;
+        } else if (HasTextures(*mData)) {
+          // remap the range into [0, 1], and the textures back
+          const Vec2f extent = uvQuant.max - uvQuant.min;
+          uvQuant.enabled = true;
+          uvQuant.offset = uvQuant.min;
+          uvQuant.scale =
+              Vec2f(extent.x > 0.0f ? extent.x : 1.0f, extent.y > 0.0f ? extent.y : 1.0f);
+          mData->hasTexCoordTransform = true;
+          mData->texCoordOffset = uvQuant.offset;
+          mData->texCoordScale = uvQuant.scale;
+          usesTextureTransform = true;
+        }
+      }
     }
 
-    for (const auto& surfaceModel : materialModels) {
-      assert(surfaceModel.GetSurfaceCount() == 1);
-      const RawSurface& rawSurface = surfaceModel.GetSurface(0);
+    for (const auto& rawPrimitive : rawPrimitives) {
+      const RawSurface& rawSurface = raw.GetSurface(rawPrimitive.surfaceIndex);
       const long surfaceId = rawSurface.id;
 
-      const RawMaterial& rawMaterial =
-          surfaceModel.GetMaterial(surfaceModel.GetTriangle(0).materialIndex);
+      const RawMaterial& rawMaterial = raw.GetMaterial(rawPrimitive.materialIndex);
       const MaterialData& mData = require(materialsById, rawMaterial.id);
 
+      auto& meshes = (rawPrimitive.lodLevel == 0) ? meshBySurfaceId
+                                                  : lodMeshesBySurfaceId[rawPrimitive.lodLevel - 1];
       MeshData* mesh = nullptr;
-      auto meshIter = meshBySurfaceId.find(surfaceId);
-      if (meshIter != meshBySurfaceId.end()) {
+      auto meshIter = meshes.find(surfaceId);
+      if (meshIter != meshes.end()) {
         mesh = meshIter->second.get();
 
       } else {
@@ -429,29 +860,32 @@ ModelData* Raw2Gltf(
         for (const auto& channel : rawSurface.blendChannels) {
           defaultDeforms.push_back(channel.defaultDeform);
         }
-        auto meshPtr = gltf->meshes.hold(new MeshData(rawSurface.name, defaultDeforms));
-        meshBySurfaceId[surfaceId] = meshPtr;
+        const std::string meshName = (rawPrimitive.lodLevel == 0)
+            ? rawSurface.name
+            : fmt::format("{}_LOD{}", rawSurface.name, rawPrimitive.lodLevel);
+        auto meshPtr = gltf->meshes.hold(new MeshData(meshName, defaultDeforms));
+        meshes[surfaceId] = meshPtr;
         mesh = meshPtr.get();
       }
 
       bool useLongIndices = (options.useLongIndices == UseLongIndicesOptions::ALWAYS) ||
           (options.useLongIndices == UseLongIndicesOptions::AUTO &&
-           surfaceModel.GetVertexCount() > 65535);
+           rawPrimitive.GetVertexCount() > 65535);
 
       std::shared_ptr<PrimitiveData> primitive;
       if (options.draco.enabled) {
-        size_t triangleCount = surfaceModel.GetTriangleCount();
+        size_t triangleCount = rawPrimitive.GetTriangleCount();
 
         // initialize Draco mesh with vertex index information
         auto dracoMesh(std::make_shared<draco::Mesh>());
         dracoMesh->SetNumFaces(triangleCount);
-        dracoMesh->set_num_points(surfaceModel.GetVertexCount());
+        dracoMesh->set_num_points(rawPrimitive.GetVertexCount());
 
         for (uint32_t ii = 0; ii < triangleCount; ii++) {
           draco::Mesh::Face face;
-          face[0] = surfaceModel.GetTriangle(ii).verts[0];
-          face[1] = surfaceModel.GetTriangle(ii).verts[1];
-          face[2] = surfaceModel.GetTriangle(ii).verts[2];
+          face[0] = rawPrimitive.indices[3 * ii + 0];
+          face[1] = rawPrimitive.indices[3 * ii + 1];
+          face[2] = rawPrimitive.indices[3 * ii + 2];
           dracoMesh->SetFace(draco::FaceIndex(ii), face);
         }
 
@@ -463,92 +897,178 @@ ModelData* Raw2Gltf(
         const AccessorData& indexes = *gltf->AddAccessorWithView(
             *gltf->GetAlignedBufferView(buffer, BufferViewData::GL_ELEMENT_ARRAY_BUFFER),
             useLongIndices ? GLT_UINT : GLT_USHORT,
-            getIndexArray(surfaceModel),
+            getIndexArray(rawPrimitive),
             std::string(""));
         primitive.reset(new PrimitiveData(indexes, mData));
       };
 
+      // store attributes the quantization has encoded already
+      const auto addEncodedAttribute = [&](const std::string& name,
+                                           const GLType& type,
+                                           const std::vector<uint8_t>& source,
+                                           const uint32_t byteStride,
+                                           const bool normalized) {
+        auto accessor = gltf->AddEncodedAccessorWithView(
+            *gltf->GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER),
+            type,
+            source,
+            byteStride,
+            normalized,
+            std::string(""));
+        primitive->AddAttrib(name, *accessor);
+        usesMeshQuantization = true;
+        return accessor;
+      };
+      auto positionQuantIter = positionQuantBySurfaceId.find(surfaceId);
+      const PositionQuantization* positionQuant =
+          (positionQuantIter != positionQuantBySurfaceId.end()) ? &positionQuantIter->second
+                                                                : nullptr;
+
       //
       // surface vertices
       //
       {
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_POSITION) != 0) {
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_POSITION) != 0 &&
+            positionQuant != nullptr) {
+          std::vector<Vec3f> positions;
+          raw.GetAttributeArray(positions, &RawVertexStreams::position, rawPrimitive);
+          Boundsf quantizedBounds;
+          auto accessor = addEncodedAttribute(
+              "POSITION",
+              GLType(CT_SHORT, 3, "VEC3"),
+              QuantizePositions(positions, *positionQuant, quantizedBounds),
+              8,
+              false);
+          accessor->min = toStdVec(quantizedBounds.min);
+          accessor->max = toStdVec(quantizedBounds.max);
+        } else if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_POSITION) != 0) {
           const AttributeDefinition<Vec3f> ATTR_POSITION(
               "POSITION",
-              &RawVertex::position,
+              &RawVertexStreams::position,
               GLT_VEC3F,
               draco::GeometryAttribute::POSITION,
               draco::DT_FLOAT32);
-          auto accessor =
-              gltf->AddAttributeToPrimitive<Vec3f>(buffer, surfaceModel, *primitive, ATTR_POSITION);
+          auto accessor = gltf->AddAttributeToPrimitive<Vec3f>(
+              buffer, raw, rawPrimitive, *primitive, ATTR_POSITION);
 
-          accessor->min = toStdVec(rawSurface.bounds.min);
-          accessor->max = toStdVec(rawSurface.bounds.max);
+          accessor->min = toStdVec(rawPrimitive.bounds.min);
+          accessor->max = toStdVec(rawPrimitive.bounds.max);
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_NORMAL) != 0) {
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_NORMAL) != 0 &&
+            quantizeNormals) {
+          std::vector<Vec3f> normals;
+          raw.GetAttributeArray(normals, &RawVertexStreams::normal, rawPrimitive);
+          const auto _ = addEncodedAttribute(
+              "NORMAL",
+              GLType(CT_BYTE, 3, "VEC3"),
+              QuantizeUnitVectors(normals, options.quantize.quantBitsNormal),
+              4,
+              true);
+        } else if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_NORMAL) != 0) {
           const AttributeDefinition<Vec3f> ATTR_NORMAL(
               "NORMAL",
-              &RawVertex::normal,
+              &RawVertexStreams::normal,
               GLT_VEC3F,
               draco::GeometryAttribute::NORMAL,
               draco::DT_FLOAT32);
-          const auto _ =
-              gltf->AddAttributeToPrimitive<Vec3f>(buffer, surfaceModel, *primitive, ATTR_NORMAL);
+          const auto _ = gltf->AddAttributeToPrimitive<Vec3f>(
+              buffer, raw, rawPrimitive, *primitive, ATTR_NORMAL, options.meshopt.normalFilter);
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_TANGENT) != 0) {
-          const AttributeDefinition<Vec4f> ATTR_TANGENT("TANGENT", &RawVertex::tangent, GLT_VEC4F);
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_TANGENT) != 0 &&
+            quantizeNormals) {
+          std::vector<Vec4f> tangents;
+          raw.GetAttributeArray(tangents, &RawVertexStreams::tangent, rawPrimitive);
+          const auto _ = addEncodedAttribute(
+              "TANGENT",
+              GLType(CT_BYTE, 4, "VEC4"),
+              QuantizeUnitVectors(tangents, options.quantize.quantBitsNormal),
+              4,
+              true);
+        } else if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_TANGENT) != 0) {
+          const AttributeDefinition<Vec4f> ATTR_TANGENT(
+              "TANGENT", &RawVertexStreams::tangent, GLT_VEC4F);
           const auto _ = gltf->AddAttributeToPrimitive<Vec4f>(
-              buffer, surfaceModel, *primitive, ATTR_TANGENT);
+              buffer, raw, rawPrimitive, *primitive, ATTR_TANGENT, options.meshopt.normalFilter);
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_COLOR) != 0) {
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_COLOR) != 0) {
           const AttributeDefinition<Vec4f> ATTR_COLOR(
               "COLOR_0",
-              &RawVertex::color,
+              &RawVertexStreams::color,
               GLT_VEC4F,
               draco::GeometryAttribute::COLOR,
               draco::DT_FLOAT32);
-          const auto _ =
-              gltf->AddAttributeToPrimitive<Vec4f>(buffer, surfaceModel, *primitive, ATTR_COLOR);
+          const auto _ = gltf->AddAttributeToPrimitive<Vec4f>(
+              buffer, raw, rawPrimitive, *primitive, ATTR_COLOR);
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_UV0) != 0) {
+        const TexCoordQuantization& uvQuant = uvQuantByMaterial[rawPrimitive.materialIndex];
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV0) != 0 && uvQuant.enabled) {
+          std::vector<Vec2f> uvs;
+          raw.GetAttributeArray(uvs, &RawVertexStreams::uv0, rawPrimitive);
+          const auto _ = addEncodedAttribute(
+              "TEXCOORD_0",
+              GLType(CT_USHORT, 2, "VEC2"),
+              QuantizeTexCoords(uvs, uvQuant, options.quantize.quantBitsTexCoord),
+              4,
+              true);
+        } else if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV0) != 0) {
           const AttributeDefinition<Vec2f> ATTR_TEXCOORD_0(
               "TEXCOORD_0",
-              &RawVertex::uv0,
+              &RawVertexStreams::uv0,
               GLT_VEC2F,
               draco::GeometryAttribute::TEX_COORD,
               draco::DT_FLOAT32);
           const auto _ = gltf->AddAttributeToPrimitive<Vec2f>(
-              buffer, surfaceModel, *primitive, ATTR_TEXCOORD_0);
+              buffer, raw, rawPrimitive, *primitive, ATTR_TEXCOORD_0);
+        }
+        // no texture reads the second set, so it is only quantized if it needs no remapping
+        std::vector<Vec2f> uv1s;
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV1) != 0 && quantize) {
+          raw.GetAttributeArray(uv1s, &RawVertexStreams::uv1, rawPrimitive);
+          Vec2f min(0.0f), max(0.0f);
+          for (size_t jj = 0; jj < uv1s.size(); jj++) {
+            min = (jj > 0) ? glm::min(min, uv1s[jj]) : uv1s[jj];
+            max = (jj > 0) ? glm::max(max, uv1s[jj]) : uv1s[jj];
+          }
+          if (!InUnitRange(min, max)) {
+            uv1s.clear();
+          }
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_UV1) != 0) {
+        if (!uv1s.empty()) {
+          const auto _ = addEncodedAttribute(
+              "TEXCOORD_1",
+              GLType(CT_USHORT, 2, "VEC2"),
+              QuantizeTexCoords(uv1s, TexCoordQuantization(), options.quantize.quantBitsTexCoord),
+              4,
+              true);
+        } else if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV1) != 0) {
           const AttributeDefinition<Vec2f> ATTR_TEXCOORD_1(
               "TEXCOORD_1",
-              &RawVertex::uv1,
+              &RawVertexStreams::uv1,
               GLT_VEC2F,
               draco::GeometryAttribute::TEX_COORD,
               draco::DT_FLOAT32);
           const auto _ = gltf->AddAttributeToPrimitive<Vec2f>(
-              buffer, surfaceModel, *primitive, ATTR_TEXCOORD_1);
+              buffer, raw, rawPrimitive, *primitive, ATTR_TEXCOORD_1);
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_JOINT_INDICES) != 0) {
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_JOINT_INDICES) != 0) {
           const AttributeDefinition<Vec4i> ATTR_JOINTS(
               "JOINTS_0",
-              &RawVertex::jointIndices,
+              &RawVertexStreams::jointIndices,
               GLT_VEC4I,
               draco::GeometryAttribute::GENERIC,
               draco::DT_UINT16);
-          const auto _ =
-              gltf->AddAttributeToPrimitive<Vec4i>(buffer, surfaceModel, *primitive, ATTR_JOINTS);
+          const auto _ = gltf->AddAttributeToPrimitive<Vec4i>(
+              buffer, raw, rawPrimitive, *primitive, ATTR_JOINTS);
         }
-        if ((surfaceModel.GetVertexAttributes() & RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS) != 0) {
+        if ((rawPrimitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS) != 0) {
           const AttributeDefinition<Vec4f> ATTR_WEIGHTS(
               "WEIGHTS_0",
-              &RawVertex::jointWeights,
+              &RawVertexStreams::jointWeights,
               GLT_VEC4F,
               draco::GeometryAttribute::GENERIC,
               draco::DT_FLOAT32);
-          const auto _ =
-              gltf->AddAttributeToPrimitive<Vec4f>(buffer, surfaceModel, *primitive, ATTR_WEIGHTS);
+          const auto _ = gltf->AddAttributeToPrimitive<Vec4f>(
+              buffer, raw, rawPrimitive, *primitive, ATTR_WEIGHTS);
         }
 
         // each channel present in the mesh always ends up a target in the primitive
@@ -557,53 +1077,152 @@ ModelData* Raw2Gltf(
 
           // track the bounds of each shape channel
           Bounds<float, 3> shapeBounds;
-
-          std::vector<Vec3f> positions, normals;
-          std::vector<Vec4f> tangents;
-          for (int jj = 0; jj < surfaceModel.GetVertexCount(); jj++) {
-            auto blendVertex = surfaceModel.GetVertex(jj).blends[channelIx];
-            shapeBounds.AddPoint(blendVertex.position);
-            positions.push_back(blendVertex.position);
-            if (options.useBlendShapeTangents && channel.hasNormals) {
+          // position deltas are in the quantized space of the positions, rounded to its grid
+          const float positionScale =
+              (positionQuant != nullptr) ? 1.0f / positionQuant->scale : 1.0f;
+
+          const bool withNormals = options.useBlendShapeNormals && channel.hasNormals;
+          const bool withTangents = options.useBlendShapeTangents && channel.hasTangents;
+
+          // only the vertices the channel moves are gathered, each attribute on its own
+          std::vector<uint32_t> positionIndices, normalIndices, tangentIndices;
+          std::vector<Vec3f> positions, normals, tangents;
+          const uint32_t vertexCount = to_uint32(rawPrimitive.GetVertexCount());
+          for (uint32_t jj = 0; jj < vertexCount; jj++) {
+            const RawBlendVertex blendVertex =
+                raw.GetBlendVertex(rawPrimitive.vertices[jj], channelIx);
+            Vec3f position = blendVertex.position * positionScale;
+            if (positionQuant != nullptr) {
+              position = glm::round(position);
+            }
+            if (position != Vec3f(0.0f)) {
+              shapeBounds.AddPoint(position);
+              positionIndices.push_back(jj);
+              positions.push_back(position);
+            }
+            if (withNormals && blendVertex.normal != Vec3f(0.0f)) {
+              normalIndices.push_back(jj);
               normals.push_back(blendVertex.normal);
             }
-            if (options.useBlendShapeTangents && channel.hasTangents) {
+            if (withTangents && blendVertex.tangent != Vec3f(0.0f)) {
+              tangentIndices.push_back(jj);
               tangents.push_back(blendVertex.tangent);
             }
           }
-          std::shared_ptr<AccessorData> pAcc = gltf->AddAccessorWithView(
-              *gltf->GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER),
-              GLT_VEC3F,
-              positions,
-              channel.name);
+          if (positionIndices.size() < vertexCount) {
+            // the vertices that stay put
+            shapeBounds.AddPoint(Vec3f(0.0f));
+          }
+
+          std::shared_ptr<AccessorData> pAcc;
+          const ComponentType* positionType =
+              (positionQuant != nullptr) ? IntegerComponentType(shapeBounds) : nullptr;
+          if (positionType != nullptr) {
+            pAcc = AddEncodedMorphTargetAccessor(
+                *gltf,
+                buffer,
+                GLType(*positionType, 3, "VEC3"),
+                vertexCount,
+                positionIndices,
+                PackDeltas(positions, *positionType),
+                false,
+                channel.name);
+            usesMeshQuantization = true;
+          } else {
+            pAcc = AddMorphTargetAccessor(
+                *gltf,
+                buffer,
+                GLT_VEC3F,
+                vertexCount,
+                positionIndices,
+                positions,
+                channel.name,
+                options.meshopt.deltaFilter);
+          }
           pAcc->min = toStdVec(shapeBounds.min);
           pAcc->max = toStdVec(shapeBounds.max);
 
-          std::shared_ptr<AccessorData> nAcc;
-          if (!normals.empty()) {
-            nAcc = gltf->AddAccessorWithView(
-                *gltf->GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER),
-                GLT_VEC3F,
-                normals,
+          // normal and tangent deltas become normalized bytes, unless some exceed their range
+          const auto addDirectionDeltas = [&](const std::vector<uint32_t>& indices,
+                                              const std::vector<Vec3f>& deltas) {
+            bool inRange = quantizeNormals;
+            for (size_t ii = 0; ii < deltas.size() && inRange; ii++) {
+              inRange = glm::all(glm::lessThanEqual(glm::abs(deltas[ii]), Vec3f(1.0f)));
+            }
+            if (!inRange) {
+              return AddMorphTargetAccessor(
+                  *gltf,
+                  buffer,
+                  GLT_VEC3F,
+                  vertexCount,
+                  indices,
+                  deltas,
+                  channel.name,
+                  options.meshopt.deltaFilter);
+            }
+            // rounded to the requested precision first, as for the normals themselves
+            const float maxValue = (float)((1 << (options.quantize.quantBitsNormal - 1)) - 1);
+            std::vector<Vec3f> scaled(deltas.size());
+            for (size_t ii = 0; ii < deltas.size(); ii++) {
+              scaled[ii] = glm::round(deltas[ii] * maxValue) * (127.0f / maxValue);
+            }
+            usesMeshQuantization = true;
+            return AddEncodedMorphTargetAccessor(
+                *gltf,
+                buffer,
+                GLType(CT_BYTE, 3, "VEC3"),
+                vertexCount,
+                indices,
+                PackDeltas(scaled, CT_BYTE),
+                true,
                 channel.name);
+          };
+
+          std::shared_ptr<AccessorData> nAcc;
+          if (withNormals) {
+            nAcc = addDirectionDeltas(normalIndices, normals);
           }
 
           std::shared_ptr<AccessorData> tAcc;
-          if (!tangents.empty()) {
-            nAcc = gltf->AddAccessorWithView(
-                *gltf->GetAlignedBufferView(buffer, BufferViewData::GL_ARRAY_BUFFER),
-                GLT_VEC4F,
-                tangents,
-                channel.name);
+          if (withTangents) {
+            tAcc = addDirectionDeltas(tangentIndices, tangents);
           }
 
           primitive->AddTarget(pAcc.get(), nAcc.get(), tAcc.get());
         }
       }
+      if (!rawPrimitive.meshlets.empty()) {
+        std::vector<uint32_t> triangleOffsets;
+        std::vector<Vec4f> bounds;
+        std::vector<Vec4f> cones;
+        for (const RawMeshlet& meshlet : rawPrimitive.meshlets) {
+          triangleOffsets.push_back(meshlet.firstTriangle);
+          if (positionQuant != nullptr) {
+            bounds.push_back(Vec4f(
+                (meshlet.center - positionQuant->offset) / positionQuant->scale,
+                meshlet.radius / positionQuant->scale));
+          } else {
+            bounds.push_back(Vec4f(meshlet.center, meshlet.radius));
+          }
+          cones.push_back(Vec4f(meshlet.coneAxis, meshlet.coneCutoff));
+        }
+        triangleOffsets.push_back(to_uint32(rawPrimitive.GetTriangleCount()));
+        primitive->AddMeshlets(
+            MESHLET_MAX_VERTICES,
+            MESHLET_MAX_TRIANGLES,
+            *gltf->AddAccessorAndView(buffer, GLT_UINT, triangleOffsets),
+            *gltf->AddAccessorAndView(buffer, GLT_VEC4F, bounds),
+            *gltf->AddAccessorAndView(buffer, GLT_VEC4F, cones));
+      }
       if (options.draco.enabled) {
         // Set up the encoder.
         draco::Encoder encoder;
 
+        if (!rawPrimitive.meshlets.empty()) {
+          // the meshlets are ranges of the index buffer, which edgebreaker would reorder
+          encoder.SetEncodingMethod(draco::MESH_SEQUENTIAL_ENCODING);
+        }
+
         if (options.draco.compressionLevel != -1) {
           int dracoSpeed = 10 - options.draco.compressionLevel;
           encoder.SetSpeedOptions(dracoSpeed, dracoSpeed);
@@ -655,18 +1274,56 @@ ModelData* Raw2Gltf(
         const RawSurface& rawSurface = raw.GetSurface(surfaceIndex);
 
         MeshData& meshData = require(meshBySurfaceId, rawSurface.id);
-        nodeData->SetMesh(meshData.ix);
+        auto positionQuantIter = positionQuantBySurfaceId.find(rawSurface.id);
+        const PositionQuantization* positionQuant =
+            (positionQuantIter != positionQuantBySurfaceId.end()) ? &positionQuantIter->second
+                                                                  : nullptr;
+        auto meshNodeIter = meshNodesById.find(node.id);
+        std::shared_ptr<NodeData> meshNode =
+            (meshNodeIter != meshNodesById.end()) ? meshNodeIter->second : nodeData;
+        if (!node.instances.empty()) {
+          // the node of the instances has no transform of its own; each instance takes over the
+          // dequantization instead, which works out as its scale is uniform
+          std::vector<Vec3f> translations, scales;
+          std::vector<Quatf> rotations;
+          for (const RawInstance& instance : node.instances) {
+            translations.push_back(instance.translation);
+            rotations.push_back(instance.rotation);
+            scales.push_back(instance.scale);
+            if (positionQuant != nullptr) {
+              translations.back() += instance.rotation * (instance.scale * positionQuant->offset);
+              scales.back() *= positionQuant->scale;
+            }
+          }
+          meshNode->instanceAttributes["TRANSLATION"] =
+              gltf->AddAccessorAndView(buffer, GLT_VEC3F, translations)->ix;
+          meshNode->instanceAttributes["ROTATION"] =
+              gltf->AddAccessorAndView(
+                      buffer, GLT_QUATF, rotations, options.meshopt.rotationFilter)
+                  ->ix;
+          meshNode->instanceAttributes["SCALE"] =
+              gltf->AddAccessorAndView(buffer, GLT_VEC3F, scales)->ix;
+        }
+        meshNode->SetMesh(meshData.ix);
 
         //
         // surface skin
         //
         if (!rawSurface.jointIds.empty()) {
-          if (nodeData->skin == -1) {
+          if (meshNode->skin == -1) {
             // glTF uses column-major matrices
             std::vector<Mat4f> inverseBindMatrices;
             for (const auto& inverseBindMatrice : rawSurface.inverseBindMatrices) {
               // glm::mat4 does not have Transpose() member — use glm::transpose
-              inverseBindMatrices.push_back(glm::transpose(inverseBindMatrice));
+              Mat4f inverseBindMatrix = glm::transpose(inverseBindMatrice);
+              if (positionQuant != nullptr) {
+                // skinned meshes ignore their node's transform, so dequantize before binding
+                inverseBindMatrix = inverseBindMatrix *
+                    glm::scale(
+                        glm::translate(Mat4f(1.0f), positionQuant->offset),
+                        Vec3f(positionQuant->scale));
+              }
+              inverseBindMatrices.push_back(inverseBindMatrix);
             }
 
             std::vector<uint32_t> jointIndexes;
@@ -679,8 +1336,29 @@ ModelData* Raw2Gltf(
 
             auto skeletonRoot = require(nodesById, rawSurface.skeletonRootId);
             auto skin = *gltf->skins.hold(new SkinData(jointIndexes, *accIBM, skeletonRoot));
-            nodeData->SetSkin(skin.ix);
+            meshNode->SetSkin(skin.ix);
+          }
+        }
+
+        //
+        // levels of detail, as alternatives to the node holding the mesh
+        //
+        auto triangleCountsIter = lodTriangleCountsBySurface.find(surfaceIndex);
+        for (const auto& entry : lodNodesById[node.id]) {
+          const size_t level = entry.first;
+          const std::shared_ptr<NodeData>& lodNode = entry.second;
+          lodNode->SetMesh(require(lodMeshesBySurfaceId[level - 1], rawSurface.id).ix);
+          lodNode->instanceAttributes = meshNode->instanceAttributes;
+          if (meshNode->skin >= 0) {
+            lodNode->SetSkin(meshNode->skin);
           }
+          if (meshNode->lods.empty()) {
+            meshNode->lodScreenCoverages.push_back(LOD_FULL_DETAIL_SCREEN_COVERAGE);
+          }
+          meshNode->lods.push_back(lodNode->ix);
+          meshNode->lodScreenCoverages.push_back(
+              LOD_FULL_DETAIL_SCREEN_COVERAGE * triangleCountsIter->second[level] /
+              triangleCountsIter->second[0]);
         }
       }
     }
@@ -806,6 +1484,34 @@ ModelData* Raw2Gltf(
       extensionsUsed.push_back(KHR_DRACO_MESH_COMPRESSION);
       extensionsRequired.push_back(KHR_DRACO_MESH_COMPRESSION);
     }
+    if (options.meshopt.enabled) {
+      // the fallback buffer carries no data, so loaders must support the extension
+      extensionsUsed.push_back(EXT_MESHOPT_COMPRESSION);
+      extensionsRequired.push_back(EXT_MESHOPT_COMPRESSION);
+      // with the octahedral filter, normals and tangents are stored as normalized shorts
+      usesMeshQuantization |= (options.meshopt.normalFilter == MeshoptFilter::OCTAHEDRAL);
+    }
+    if (usesMeshQuantization) {
+      extensionsUsed.push_back(KHR_MESH_QUANTIZATION);
+      extensionsRequired.push_back(KHR_MESH_QUANTIZATION);
+    }
+    if (std::any_of(gltf->nodes.ptrs.begin(), gltf->nodes.ptrs.end(), [](const auto& node) {
+          return !node->instanceAttributes.empty();
+        })) {
+      extensionsUsed.push_back(EXT_MESH_GPU_INSTANCING);
+      extensionsRequired.push_back(EXT_MESH_GPU_INSTANCING);
+    }
+    if (std::any_of(
+            lodMeshesBySurfaceId.begin(), lodMeshesBySurfaceId.end(), [](const auto& meshes) {
+              return !meshes.empty();
+            })) {
+      // loaders without it just show the full detail
+      extensionsUsed.push_back(MSFT_LOD);
+    }
+    if (usesTextureTransform) {
+      extensionsUsed.push_back(KHR_TEXTURE_TRANSFORM);
+      extensionsRequired.push_back(KHR_TEXTURE_TRANSFORM);
+    }
 
     json glTFJson{{"asset", {{"generator", "FBX2glTF v" + FBX2GLTF_VERSION}, {"version", "2.0"}}},
                   {"scene", rootScene.ix}};
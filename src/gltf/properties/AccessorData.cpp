@@ -27,12 +27,24 @@ json AccessorData::serialize() const {
     result["bufferView"] = bufferView;
     result["byteOffset"] = byteOffset;
   }
+  if (normalized) {
+    result["normalized"] = true;
+  }
   if (!min.empty()) {
     result["min"] = min;
   }
   if (!max.empty()) {
     result["max"] = max;
   }
+  if (sparseCount > 0) {
+    result["sparse"] = {
+        {"count", sparseCount},
+        {"indices",
+         {{"bufferView", sparseIndicesBufferView},
+          {"byteOffset", 0},
+          {"componentType", sparseIndicesComponentType}}},
+        {"values", {{"bufferView", sparseValuesBufferView}, {"byteOffset", 0}}}};
+  }
   if (name.length() > 0) {
     result["name"] = name;
   }
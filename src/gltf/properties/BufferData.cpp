@@ -11,16 +11,28 @@
 
 #include <gltf/properties/BufferData.hpp>
 
+BufferData::BufferData()
+    : Holdable(), isGlb(false), binData(nullptr), isMeshoptFallback(true) {}
+
 BufferData::BufferData(const std::shared_ptr<const std::vector<uint8_t>>& binData)
-    : Holdable(), isGlb(true), binData(binData) {}
+    : Holdable(), isGlb(true), binData(binData), isMeshoptFallback(false) {}
 
 BufferData::BufferData(
     std::string uri,
     const std::shared_ptr<const std::vector<uint8_t>>& binData,
     bool isEmbedded)
-    : Holdable(), isGlb(false), uri(isEmbedded ? "" : std::move(uri)), binData(binData) {}
+    : Holdable(),
+      isGlb(false),
+      uri(isEmbedded ? "" : std::move(uri)),
+      binData(binData),
+      isMeshoptFallback(false) {}
 
 json BufferData::serialize() const {
+  if (isMeshoptFallback) {
+    return {
+        {"byteLength", fallbackByteLength},
+        {"extensions", {{EXT_MESHOPT_COMPRESSION, {{"fallback", true}}}}}};
+  }
   json result{{"byteLength", binData->size()}};
   if (!isGlb) {
     if (!uri.empty()) {
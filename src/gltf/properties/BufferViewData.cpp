@@ -17,6 +17,24 @@ BufferViewData::BufferViewData(
 
 json BufferViewData::serialize() const {
   json result{{"buffer", buffer}, {"byteLength", byteLength}, {"byteOffset", byteOffset}};
+  if (fallbackBuffer >= 0) {
+    result["buffer"] = fallbackBuffer;
+    result["byteOffset"] = fallbackByteOffset;
+    json compression{
+        {"buffer", buffer},
+        {"byteOffset", byteOffset},
+        {"byteLength", compressedByteLength},
+        {"byteStride", compressedByteStride},
+        {"count", compressedCount},
+        {"mode", compressionMode}};
+    if (compressionFilter != "NONE") {
+      compression["filter"] = compressionFilter;
+    }
+    result["extensions"][EXT_MESHOPT_COMPRESSION] = compression;
+  }
+  if (byteStride > 0) {
+    result["byteStride"] = byteStride;
+  }
   if (target != GL_ARRAY_NONE) {
     result["target"] = target;
   }
@@ -121,6 +121,23 @@ json MaterialData::serialize() const {
     extensions[KHR_MATERIALS_CMN_UNLIT] = *khrCmnConstantMaterial;
     result["extensions"] = extensions;
   }
+  if (hasTexCoordTransform) {
+    const json transform = {{"offset", toStdVec(texCoordOffset)},
+                            {"scale", toStdVec(texCoordScale)}};
+    for (const char* key : {"normalTexture", "occlusionTexture", "emissiveTexture"}) {
+      if (result.count(key) > 0) {
+        result[key]["extensions"][KHR_TEXTURE_TRANSFORM] = transform;
+      }
+    }
+    if (result.count("pbrMetallicRoughness") > 0) {
+      json& pbr = result["pbrMetallicRoughness"];
+      for (const char* key : {"baseColorTexture", "metallicRoughnessTexture"}) {
+        if (pbr.count(key) > 0) {
+          pbr[key]["extensions"][KHR_TEXTURE_TRANSFORM] = transform;
+        }
+      }
+    }
+  }
 
   for (const auto& i : userProperties) {
     auto& prop_map = result["extras"]["fromFBX"]["userProperties"];
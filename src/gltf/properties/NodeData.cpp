@@ -88,6 +88,13 @@ json NodeData::serialize() const {
     if (light >= 0) {
       result["extensions"][KHR_LIGHTS_PUNCTUAL]["light"] = light;
     }
+    if (!instanceAttributes.empty()) {
+      result["extensions"][EXT_MESH_GPU_INSTANCING]["attributes"] = instanceAttributes;
+    }
+    if (!lods.empty()) {
+      result["extensions"][MSFT_LOD]["ids"] = lods;
+      result["extras"]["MSFT_screencoverage"] = lodScreenCoverages;
+    }
   }
 
   for (const auto& i : userProperties) {
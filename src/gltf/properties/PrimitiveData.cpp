@@ -37,6 +37,19 @@ void PrimitiveData::NoteDracoBuffer(const BufferViewData& data) {
   dracoBufferView = data.ix;
 }
 
+void PrimitiveData::AddMeshlets(
+    const int maxVertices,
+    const int maxTriangles,
+    const AccessorData& triangleOffsets,
+    const AccessorData& bounds,
+    const AccessorData& cones) {
+  meshlets = {{"maxVertices", maxVertices},
+              {"maxTriangles", maxTriangles},
+              {"triangleOffsets", triangleOffsets.ix},
+              {"bounds", bounds.ix},
+              {"cones", cones.ix}};
+}
+
 void PrimitiveData::AddTarget(
     const AccessorData* positions,
     const AccessorData* normals,
@@ -72,6 +85,9 @@ void to_json(json& j, const PrimitiveData& d) {
     }
     j["targets"] = targets;
   }
+  if (!d.meshlets.is_null()) {
+    j["extras"]["meshlets"] = d.meshlets;
+  }
   if (!d.dracoAttributes.empty()) {
     j["extensions"] = {{KHR_DRACO_MESH_COMPRESSION,
                         {{"bufferView", d.dracoBufferView}, {"attributes", d.dracoAttributes}}}};
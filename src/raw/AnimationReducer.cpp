@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "raw/AnimationReducer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// The keys that linear interpolation needs to stay within tolerance of every sample, found by
+// Ramer-Douglas-Peucker: deviation(from, to, ii) is how far sample ii strays from the interpolation
+// between samples from and to.
+template <typename Deviation>
+static std::vector<size_t>
+FitLinear(const size_t count, const float tolerance, const Deviation& deviation) {
+  std::vector<bool> keep(count, false);
+  keep[0] = keep[count - 1] = true;
+  // an explicit stack, as long clips would otherwise recurse deep
+  std::vector<std::pair<size_t, size_t>> spans{{0, count - 1}};
+  while (!spans.empty()) {
+    const std::pair<size_t, size_t> span = spans.back();
+    spans.pop_back();
+    size_t worst = span.first;
+    float worstDeviation = tolerance;
+    for (size_t ii = span.first + 1; ii < span.second; ii++) {
+      const float sampleDeviation = deviation(span.first, span.second, ii);
+      if (sampleDeviation > worstDeviation) {
+        worst = ii;
+        worstDeviation = sampleDeviation;
+      }
+    }
+    if (worst != span.first) {
+      keep[worst] = true;
+      spans.emplace_back(span.first, worst);
+      spans.emplace_back(worst, span.second);
+    }
+  }
+
+  std::vector<size_t> keys;
+  for (size_t ii = 0; ii < count; ii++) {
+    if (keep[ii]) {
+      keys.push_back(ii);
+    }
+  }
+  return keys;
+}
+
+// The keys that holding each value until the next key needs to stay within tolerance of every
+// sample: difference(key, ii) is how far sample ii strays from sample key. The last sample is
+// always kept, so the channel still spans the full duration of the animation.
+template <typename Difference>
+static std::vector<size_t>
+FitStep(const size_t count, const float tolerance, const Difference& difference) {
+  std::vector<size_t> keys{0};
+  for (size_t ii = 1; ii < count; ii++) {
+    if (difference(keys.back(), ii) > tolerance) {
+      keys.push_back(ii);
+    }
+  }
+  if (keys.back() != count - 1) {
+    keys.push_back(count - 1);
+  }
+  return keys;
+}
+
+// Reduce the keys of one property, whose values hold as many elements per key as there are
+// elements in total over times (one for most, one per morph target for weights).
+template <typename T, typename Interpolate, typename Error>
+static void ReduceKeys(
+    std::vector<T>& values,
+    RawKeyTiming& timing,
+    const std::vector<float>& times,
+    const float tolerance,
+    const Interpolate& interpolate,
+    const Error& error) {
+  const size_t count = times.size();
+  if (values.empty() || count < 2) {
+    return;
+  }
+  const size_t stride = values.size() / count;
+
+  const auto deviation = [&](const size_t from, const size_t to, const size_t ii) {
+    const float t = (times[ii] - times[from]) / (times[to] - times[from]);
+    float result = 0.0f;
+    for (size_t jj = 0; jj < stride; jj++) {
+      const T expected = interpolate(values[from * stride + jj], values[to * stride + jj], t);
+      result = std::max(result, error(expected, values[ii * stride + jj]));
+    }
+    return result;
+  };
+  const auto difference = [&](const size_t key, const size_t ii) {
+    float result = 0.0f;
+    for (size_t jj = 0; jj < stride; jj++) {
+      result = std::max(result, error(values[key * stride + jj], values[ii * stride + jj]));
+    }
+    return result;
+  };
+
+  const std::vector<size_t> linearKeys = FitLinear(count, tolerance, deviation);
+  const std::vector<size_t> stepKeys = FitStep(count, tolerance, difference);
+  const bool step = stepKeys.size() < linearKeys.size();
+  const std::vector<size_t>& keys = step ? stepKeys : linearKeys;
+  if (keys.size() == count) {
+    return;
+  }
+
+  std::vector<T> keptValues;
+  keptValues.reserve(keys.size() * stride);
+  timing.times.clear();
+  for (const size_t key : keys) {
+    keptValues.insert(
+        keptValues.end(), values.begin() + key * stride, values.begin() + (key + 1) * stride);
+    timing.times.push_back(times[key]);
+  }
+  values = std::move(keptValues);
+  timing.interpolation = step ? RAW_INTERPOLATION_STEP : RAW_INTERPOLATION_LINEAR;
+}
+
+void ReduceChannelKeys(
+    RawChannel& channel,
+    const std::vector<float>& times,
+    const decltype(GltfOptions::keyReduction)& tolerances) {
+  const auto lerp = [](const auto& a, const auto& b, const float t) { return a + (b - a) * t; };
+  const auto largestComponent = [](const Vec3f& a, const Vec3f& b) {
+    const Vec3f delta = glm::abs(a - b);
+    return std::max(delta.x, std::max(delta.y, delta.z));
+  };
+
+  ReduceKeys(
+      channel.translations,
+      channel.translationTiming,
+      times,
+      tolerances.translationError,
+      lerp,
+      [](const Vec3f& a, const Vec3f& b) { return glm::length(a - b); });
+  ReduceKeys(
+      channel.rotations,
+      channel.rotationTiming,
+      times,
+      tolerances.rotationError,
+      [](const Quatf& a, const Quatf& b, const float t) { return glm::slerp(a, b, t); },
+      [](const Quatf& a, const Quatf& b) {
+        // the angle of the rotation between them; unlike acos(dot), precise for tiny angles
+        const Quatf delta = glm::inverse(a) * b;
+        const float angle =
+            2.0f * std::atan2(glm::length(Vec3f(delta.x, delta.y, delta.z)), std::fabs(delta.w));
+        return glm::degrees(angle);
+      });
+  ReduceKeys(
+      channel.scales, channel.scaleTiming, times, tolerances.scaleError, lerp, largestComponent);
+  ReduceKeys(
+      channel.weights,
+      channel.weightTiming,
+      times,
+      tolerances.scaleError,
+      lerp,
+      [](const float a, const float b) { return std::fabs(a - b); });
+}
@@ -0,0 +1,410 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "raw/PrimitiveOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// The LRU cache the optimizer models; larger than the measuring FIFO, as the paper recommends.
+static const int FORSYTH_CACHE_SIZE = 32;
+
+// Simulates a FIFO post-transform cache of VERTEX_CACHE_FIFO_SIZE entries.
+class VertexFifo {
+ public:
+  explicit VertexFifo(const size_t vertexCount) : loadedAt(vertexCount, 0) {}
+
+  // Returns 1 if the vertex had to be transformed, 0 if it was found in the cache.
+  int Fetch(const uint32_t vertIx) {
+    // a vertex is cached if fewer than VERTEX_CACHE_FIFO_SIZE misses happened since it was loaded
+    if (misses - loadedAt[vertIx] >= VERTEX_CACHE_FIFO_SIZE) {
+      loadedAt[vertIx] = ++misses;
+      return 1;
+    }
+    return 0;
+  }
+  int FetchTriangle(const uint32_t* verts) {
+    return Fetch(verts[0]) + Fetch(verts[1]) + Fetch(verts[2]);
+  }
+  // Forget everything, as if another draw had flushed the cache.
+  void Flush() {
+    misses += VERTEX_CACHE_FIFO_SIZE;
+  }
+
+ private:
+  std::vector<size_t> loadedAt;
+  size_t misses = VERTEX_CACHE_FIFO_SIZE;
+};
+
+size_t CountVertexCacheMisses(const RawPrimitive& primitive) {
+  VertexFifo fifo(primitive.GetVertexCount());
+  size_t misses = 0;
+  for (const uint32_t vertIx : primitive.indices) {
+    misses += fifo.Fetch(vertIx);
+  }
+  return misses;
+}
+
+static float VertexScore(const int cachePosition, const uint32_t liveTriangles) {
+  if (liveTriangles == 0) {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // the vertices of the last triangle get a fixed score, so its neighbours aren't favoured
+      // over the ones that share an edge
+      score = 0.75f;
+    } else {
+      score = powf(1.0f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+  }
+  // boost vertices with few triangles left, so they get finished off rather than left stranded
+  return score + 2.0f / sqrtf((float)liveTriangles);
+}
+
+void OptimizeVertexCache(RawPrimitive& primitive) {
+  const size_t triangleCount = primitive.GetTriangleCount();
+  const size_t vertexCount = primitive.GetVertexCount();
+  if (triangleCount < 2) {
+    return;
+  }
+  const std::vector<uint32_t>& indices = primitive.indices;
+
+  // vertex -> triangle adjacency (CSR); the first liveTriangles[v] entries of each range are the
+  // triangles of the vertex that have yet to be emitted
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (const uint32_t vertIx : indices) {
+    adjacencyOffsets[vertIx + 1]++;
+  }
+  for (size_t vertIx = 0; vertIx < vertexCount; vertIx++) {
+    adjacencyOffsets[vertIx + 1] += adjacencyOffsets[vertIx];
+  }
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> liveTriangles(vertexCount, 0);
+  for (size_t ix = 0; ix < indices.size(); ix++) {
+    const uint32_t vertIx = indices[ix];
+    adjacency[adjacencyOffsets[vertIx] + liveTriangles[vertIx]++] = (uint32_t)(ix / 3);
+  }
+
+  std::vector<int> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t vertIx = 0; vertIx < vertexCount; vertIx++) {
+    vertexScores[vertIx] = VertexScore(-1, liveTriangles[vertIx]);
+  }
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<uint8_t> emitted(triangleCount, 0);
+  int bestTriangle = 0;
+  for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+    triangleScores[triIx] = vertexScores[indices[triIx * 3 + 0]] +
+        vertexScores[indices[triIx * 3 + 1]] + vertexScores[indices[triIx * 3 + 2]];
+    if (triangleScores[triIx] > triangleScores[bestTriangle]) {
+      bestTriangle = (int)triIx;
+    }
+  }
+
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> nextCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+  std::vector<uint32_t> newIndices;
+  newIndices.reserve(indices.size());
+  size_t fallbackTriangle = 0;
+
+  while (newIndices.size() < indices.size()) {
+    if (bestTriangle < 0) {
+      // no cached vertex has triangles left; restart from the first triangle not yet emitted
+      while (emitted[fallbackTriangle] != 0) {
+        fallbackTriangle++;
+      }
+      bestTriangle = (int)fallbackTriangle;
+    }
+    emitted[bestTriangle] = 1;
+
+    // emit the triangle and push its vertices to the front of the cache
+    nextCache.clear();
+    for (int corner = 0; corner < 3; corner++) {
+      const uint32_t vertIx = indices[bestTriangle * 3 + corner];
+      newIndices.push_back(vertIx);
+
+      uint32_t* live = &adjacency[adjacencyOffsets[vertIx]];
+      for (uint32_t adjIx = 0; adjIx < liveTriangles[vertIx]; adjIx++) {
+        if (live[adjIx] == (uint32_t)bestTriangle) {
+          std::swap(live[adjIx], live[liveTriangles[vertIx] - 1]);
+          liveTriangles[vertIx]--;
+          break;
+        }
+      }
+      if (std::find(nextCache.begin(), nextCache.end(), vertIx) == nextCache.end()) {
+        nextCache.push_back(vertIx);
+      }
+    }
+    for (const uint32_t vertIx : cache) {
+      if (std::find(nextCache.begin(), nextCache.end(), vertIx) == nextCache.end()) {
+        nextCache.push_back(vertIx);
+      }
+    }
+
+    // rescore every vertex whose cache position changed, including those that fell out of it
+    bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (size_t position = 0; position < nextCache.size(); position++) {
+      const uint32_t vertIx = nextCache[position];
+      cachePositions[vertIx] = position < FORSYTH_CACHE_SIZE ? (int)position : -1;
+      const float score = VertexScore(cachePositions[vertIx], liveTriangles[vertIx]);
+      const float delta = score - vertexScores[vertIx];
+      vertexScores[vertIx] = score;
+      const uint32_t* live = &adjacency[adjacencyOffsets[vertIx]];
+      for (uint32_t adjIx = 0; adjIx < liveTriangles[vertIx]; adjIx++) {
+        triangleScores[live[adjIx]] += delta;
+      }
+    }
+    // the next triangle is the best one touching the cache
+    if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+      nextCache.resize(FORSYTH_CACHE_SIZE);
+    }
+    for (const uint32_t vertIx : nextCache) {
+      const uint32_t* live = &adjacency[adjacencyOffsets[vertIx]];
+      for (uint32_t adjIx = 0; adjIx < liveTriangles[vertIx]; adjIx++) {
+        if (triangleScores[live[adjIx]] > bestScore) {
+          bestScore = triangleScores[live[adjIx]];
+          bestTriangle = (int)live[adjIx];
+        }
+      }
+    }
+    std::swap(cache, nextCache);
+  }
+
+  primitive.indices = std::move(newIndices);
+}
+
+void OptimizeOverdraw(
+    RawPrimitive& primitive,
+    const std::vector<Vec3f>& positions,
+    const float threshold) {
+  const size_t triangleCount = primitive.GetTriangleCount();
+  if (triangleCount < 2) {
+    return;
+  }
+  const std::vector<uint32_t>& indices = primitive.indices;
+  VertexFifo fifo(primitive.GetVertexCount());
+
+  // hard boundaries: triangles that miss on all three vertices, where the cache order restarted
+  std::vector<size_t> hardStarts{0};
+  for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+    if (fifo.FetchTriangle(&indices[triIx * 3]) == 3 && triIx > 0) {
+      hardStarts.push_back(triIx);
+    }
+  }
+  hardStarts.push_back(triangleCount);
+
+  // soft boundaries: split each hard cluster wherever the part since the last split, drawn from a
+  // cold cache, stays within threshold times the miss ratio of the whole hard cluster
+  std::vector<size_t> clusterStarts;
+  for (size_t hardIx = 0; hardIx + 1 < hardStarts.size(); hardIx++) {
+    const size_t begin = hardStarts[hardIx];
+    const size_t end = hardStarts[hardIx + 1];
+    fifo.Flush();
+    size_t clusterMisses = 0;
+    for (size_t triIx = begin; triIx < end; triIx++) {
+      clusterMisses += fifo.FetchTriangle(&indices[triIx * 3]);
+    }
+    const float maxRatio = threshold * (float)clusterMisses / (float)(end - begin);
+
+    clusterStarts.push_back(begin);
+    fifo.Flush();
+    size_t runningMisses = 0;
+    size_t runningTriangles = 0;
+    for (size_t triIx = begin; triIx < end; triIx++) {
+      runningMisses += fifo.FetchTriangle(&indices[triIx * 3]);
+      runningTriangles++;
+      if (triIx + 1 < end && (float)runningMisses <= maxRatio * (float)runningTriangles) {
+        clusterStarts.push_back(triIx + 1);
+        fifo.Flush();
+        runningMisses = 0;
+        runningTriangles = 0;
+      }
+    }
+  }
+  const size_t clusterCount = clusterStarts.size();
+  clusterStarts.push_back(triangleCount);
+  if (clusterCount < 2) {
+    return;
+  }
+
+  // area-weighted centroid and normal of each cluster, and the centroid of the whole primitive
+  std::vector<Vec3f> clusterCentroids(clusterCount, Vec3f{0.0f});
+  std::vector<Vec3f> clusterNormals(clusterCount, Vec3f{0.0f});
+  Vec3f meshCentroid = Vec3f{0.0f};
+  float meshArea = 0.0f;
+  for (size_t clusterIx = 0; clusterIx < clusterCount; clusterIx++) {
+    float clusterArea = 0.0f;
+    for (size_t triIx = clusterStarts[clusterIx]; triIx < clusterStarts[clusterIx + 1]; triIx++) {
+      const Vec3f& p0 = positions[primitive.vertices[indices[triIx * 3 + 0]]];
+      const Vec3f& p1 = positions[primitive.vertices[indices[triIx * 3 + 1]]];
+      const Vec3f& p2 = positions[primitive.vertices[indices[triIx * 3 + 2]]];
+      const Vec3f normal = glm::cross(p1 - p0, p2 - p0);
+      const float area = sqrtf(glm::dot(normal, normal));
+      clusterCentroids[clusterIx] += (p0 + p1 + p2) * (area / 3.0f);
+      clusterNormals[clusterIx] += normal;
+      clusterArea += area;
+    }
+    meshCentroid += clusterCentroids[clusterIx];
+    meshArea += clusterArea;
+    if (clusterArea > 0.0f) {
+      clusterCentroids[clusterIx] /= clusterArea;
+    }
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+
+  // clusters that face away from the middle of the primitive are likely to occlude the rest of it
+  // from wherever they are visible, so they are drawn first
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t clusterIx = 0; clusterIx < clusterCount; clusterIx++) {
+    const Vec3f& normal = clusterNormals[clusterIx];
+    const float length = sqrtf(glm::dot(normal, normal));
+    sortKeys[clusterIx] = length > 0.0f
+        ? glm::dot(clusterCentroids[clusterIx] - meshCentroid, normal / length)
+        : 0.0f;
+  }
+  std::vector<size_t> clusterOrder(clusterCount);
+  for (size_t clusterIx = 0; clusterIx < clusterCount; clusterIx++) {
+    clusterOrder[clusterIx] = clusterIx;
+  }
+  std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t a, size_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<uint32_t> newIndices;
+  newIndices.reserve(indices.size());
+  for (const size_t clusterIx : clusterOrder) {
+    newIndices.insert(
+        newIndices.end(),
+        indices.begin() + clusterStarts[clusterIx] * 3,
+        indices.begin() + clusterStarts[clusterIx + 1] * 3);
+  }
+  primitive.indices = std::move(newIndices);
+}
+
+void OptimizeVertexFetch(RawPrimitive& primitive) {
+  std::vector<uint32_t> remap(primitive.GetVertexCount(), UINT32_MAX);
+  std::vector<int> newVertices;
+  newVertices.reserve(primitive.vertices.size());
+  for (uint32_t& vertIx : primitive.indices) {
+    if (remap[vertIx] == UINT32_MAX) {
+      remap[vertIx] = (uint32_t)newVertices.size();
+      newVertices.push_back(primitive.vertices[vertIx]);
+    }
+    vertIx = remap[vertIx];
+  }
+  primitive.vertices = std::move(newVertices);
+}
+
+static void FinishMeshlet(
+    RawMeshlet& meshlet,
+    const RawPrimitive& primitive,
+    const std::vector<Vec3f>& positions) {
+  const auto position = [&](const uint32_t triIx, const int corner) -> const Vec3f& {
+    return positions[primitive.vertices[primitive.indices[triIx * 3 + corner]]];
+  };
+  const uint32_t end = meshlet.firstTriangle + meshlet.triangleCount;
+
+  Bounds<float, 3> bounds;
+  Vec3f normalSum = Vec3f{0.0f};
+  std::vector<Vec3f> normals;
+  normals.reserve(meshlet.triangleCount);
+  for (uint32_t triIx = meshlet.firstTriangle; triIx < end; triIx++) {
+    for (int corner = 0; corner < 3; corner++) {
+      bounds.AddPoint(position(triIx, corner));
+    }
+    const Vec3f& p0 = position(triIx, 0);
+    const Vec3f normal = glm::cross(position(triIx, 1) - p0, position(triIx, 2) - p0);
+    const float length = sqrtf(glm::dot(normal, normal));
+    if (length > 0.0f) {
+      normals.push_back(normal / length);
+      normalSum += normals.back();
+    }
+  }
+
+  meshlet.center = Vec3f(
+      (bounds.min[0] + bounds.max[0]) * 0.5f,
+      (bounds.min[1] + bounds.max[1]) * 0.5f,
+      (bounds.min[2] + bounds.max[2]) * 0.5f);
+  float radiusSquared = 0.0f;
+  for (uint32_t triIx = meshlet.firstTriangle; triIx < end; triIx++) {
+    for (int corner = 0; corner < 3; corner++) {
+      const Vec3f offset = position(triIx, corner) - meshlet.center;
+      radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+  }
+  meshlet.radius = sqrtf(radiusSquared);
+
+  // a cone the cluster can be backface-culled with: it is invisible from camera position C if
+  // dot(center - C, coneAxis) >= coneCutoff * length(center - C) + radius
+  meshlet.coneAxis = Vec3f{0.0f};
+  meshlet.coneCutoff = 1.0f;
+  const float sumLength = sqrtf(glm::dot(normalSum, normalSum));
+  if (sumLength <= 0.0f) {
+    return;
+  }
+  const Vec3f axis = normalSum / sumLength;
+  float minDot = 1.0f;
+  for (const Vec3f& normal : normals) {
+    minDot = std::min(minDot, glm::dot(normal, axis));
+  }
+  if (minDot <= 0.0f) {
+    // the normals span more than a hemisphere, so no view direction sees only back faces
+    return;
+  }
+  meshlet.coneAxis = axis;
+  meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+void BuildMeshlets(RawPrimitive& primitive, const std::vector<Vec3f>& positions) {
+  const uint32_t triangleCount = (uint32_t)primitive.GetTriangleCount();
+  primitive.meshlets.clear();
+
+  // the meshlet each local vertex was last counted for
+  std::vector<uint32_t> owners(primitive.GetVertexCount(), UINT32_MAX);
+  RawMeshlet meshlet;
+  int vertexCount = 0;
+  for (uint32_t triIx = 0; triIx < triangleCount; triIx++) {
+    const uint32_t* verts = &primitive.indices[triIx * 3];
+    const auto countNewVertices = [&](const uint32_t owner) {
+      return (owners[verts[0]] != owner ? 1 : 0) +
+          (owners[verts[1]] != owner && verts[1] != verts[0] ? 1 : 0) +
+          (owners[verts[2]] != owner && verts[2] != verts[0] && verts[2] != verts[1] ? 1 : 0);
+    };
+    uint32_t owner = (uint32_t)primitive.meshlets.size();
+    int newVertices = countNewVertices(owner);
+    if (meshlet.triangleCount == MESHLET_MAX_TRIANGLES ||
+        vertexCount + newVertices > MESHLET_MAX_VERTICES) {
+      FinishMeshlet(meshlet, primitive, positions);
+      primitive.meshlets.push_back(meshlet);
+      meshlet = RawMeshlet();
+      meshlet.firstTriangle = triIx;
+      vertexCount = 0;
+      owner++;
+      newVertices = countNewVertices(owner);
+    }
+    for (int corner = 0; corner < 3; corner++) {
+      owners[verts[corner]] = owner;
+    }
+    vertexCount += newVertices;
+    meshlet.triangleCount++;
+  }
+  if (meshlet.triangleCount > 0) {
+    FinishMeshlet(meshlet, primitive, positions);
+    primitive.meshlets.push_back(meshlet);
+  }
+}
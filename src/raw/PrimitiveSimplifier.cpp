@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "raw/PrimitiveSimplifier.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <meshoptimizer.h>
+
+#include "raw/PrimitiveOptimizer.hpp"
+
+// How much normal deviation counts against a collapse, next to the (relative) position error.
+static const float NORMAL_ERROR_WEIGHT = 0.5f;
+
+static int DominantJoint(const Vec4i& indices, const Vec4f& weights) {
+  int best = 0;
+  for (int ii = 1; ii < 4; ii++) {
+    if (weights[ii] > weights[best]) {
+      best = ii;
+    }
+  }
+  return indices[best];
+}
+
+RawPrimitive SimplifyPrimitive(
+    const RawModel& raw,
+    const RawPrimitive& primitive,
+    const float targetRatio,
+    const float targetError) {
+  RawPrimitive result = primitive;
+  result.meshlets.clear();
+
+  std::vector<Vec3f> positions;
+  raw.GetAttributeArray(positions, &RawVertexStreams::position, primitive);
+
+  std::vector<Vec3f> normals;
+  if ((primitive.vertexAttributes & RAW_VERTEX_ATTRIBUTE_NORMAL) != 0) {
+    raw.GetAttributeArray(normals, &RawVertexStreams::normal, primitive);
+  }
+  const float normalWeights[3] = {NORMAL_ERROR_WEIGHT, NORMAL_ERROR_WEIGHT, NORMAL_ERROR_WEIGHT};
+
+  // lock the corners of triangles that straddle two dominant joints, so the skin still bends
+  // along the same edges
+  std::vector<unsigned char> locked;
+  const int skinAttributes =
+      RAW_VERTEX_ATTRIBUTE_JOINT_INDICES | RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS;
+  if ((primitive.vertexAttributes & skinAttributes) == skinAttributes) {
+    std::vector<Vec4i> jointIndices;
+    std::vector<Vec4f> jointWeights;
+    raw.GetAttributeArray(jointIndices, &RawVertexStreams::jointIndices, primitive);
+    raw.GetAttributeArray(jointWeights, &RawVertexStreams::jointWeights, primitive);
+    std::vector<int> dominantJoints(primitive.vertices.size());
+    for (size_t vertIx = 0; vertIx < dominantJoints.size(); vertIx++) {
+      dominantJoints[vertIx] = DominantJoint(jointIndices[vertIx], jointWeights[vertIx]);
+    }
+    locked.resize(primitive.vertices.size(), 0);
+    for (size_t ii = 0; ii < primitive.indices.size(); ii += 3) {
+      const uint32_t* corners = &primitive.indices[ii];
+      if (dominantJoints[corners[0]] != dominantJoints[corners[1]] ||
+          dominantJoints[corners[0]] != dominantJoints[corners[2]]) {
+        locked[corners[0]] = locked[corners[1]] = locked[corners[2]] = 1;
+      }
+    }
+  }
+
+  const size_t targetIndexCount = 3 * (size_t)(primitive.GetTriangleCount() * targetRatio);
+  float resultError = 0.0f;
+  result.indices.resize(primitive.indices.size());
+  result.indices.resize(meshopt_simplifyWithAttributes(
+      result.indices.data(),
+      primitive.indices.data(),
+      primitive.indices.size(),
+      &positions[0].x,
+      positions.size(),
+      sizeof(Vec3f),
+      normals.empty() ? nullptr : &normals[0].x,
+      normals.empty() ? 0 : sizeof(Vec3f),
+      normalWeights,
+      normals.empty() ? 0 : 3,
+      locked.empty() ? nullptr : locked.data(),
+      targetIndexCount,
+      targetError,
+      meshopt_SimplifyLockBorder,
+      &resultError));
+
+  // drop the vertices no triangle uses any more, and fit the bounds to the rest
+  OptimizeVertexFetch(result);
+  const std::vector<Vec3f>& modelPositions = raw.GetAttributeArray(&RawVertexStreams::position);
+  result.bounds.Clear();
+  for (const int vertIx : result.vertices) {
+    result.bounds.AddPoint(modelPositions[vertIx]);
+  }
+  return result;
+}
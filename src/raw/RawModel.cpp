@@ -9,9 +9,10 @@
 #include <raw/RawModel.hpp>
 
 #include <cmath>
-#include <set>
+#include <cstring>
+#include <map>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 #if defined(__unix__)
@@ -20,26 +21,98 @@
 
 #include "utils/Image_Utils.hpp"
 #include "utils/String_Utils.hpp"
+#include "utils/Thread_Utils.hpp"
 
 // Using GLM helpers for vector ops (to replace mathfu methods)
 #include <glm/glm.hpp>
 #include <glm/gtc/epsilon.hpp>
 
-size_t VertexHasher::operator()(const RawVertex& v) const {
-  size_t seed = 5381;
-  const auto hasher = std::hash<float>{};
-  seed ^= hasher(v.position[0]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-  seed ^= hasher(v.position[1]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-  seed ^= hasher(v.position[2]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+#include <mikktspace.h>
+
+static inline uint64_t HashBytes(uint64_t seed, const void* data, const size_t length) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i + 4 <= length; i += 4) {
+    uint32_t word;
+    memcpy(&word, bytes + i, 4);
+    seed = (seed ^ word) * 0x9e3779b97f4a7c15ull;
+    seed ^= seed >> 32;
+  }
   return seed;
 }
 
+uint32_t VertexTable::Hash(const RawVertex& v, const int attributes) {
+  uint64_t seed = 5381;
+  const auto hashAttribute = [&](const RawVertexAttribute attrib, const auto& value) {
+    if ((attributes & attrib) != 0) {
+      seed = HashBytes(seed, &value, sizeof(value));
+    }
+  };
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_POSITION, v.position);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_NORMAL, v.normal);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_TANGENT, v.tangent);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_BINORMAL, v.binormal);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_COLOR, v.color);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_UV0, v.uv0);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_UV1, v.uv1);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_JOINT_INDICES, v.jointIndices);
+  hashAttribute(RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS, v.jointWeights);
+  seed = HashBytes(seed, &v.blendSurfaceIx, sizeof(v.blendSurfaceIx));
+  seed = (seed ^ (v.polarityUv0 ? 1 : 0)) * 0x9e3779b97f4a7c15ull;
+
+  // final avalanche, so the low bits used for slot selection depend on every input word
+  seed ^= seed >> 33;
+  seed *= 0xff51afd7ed558ccdull;
+  seed ^= seed >> 33;
+  return (uint32_t)seed;
+}
+
+void VertexTable::Clear(const int attributes) {
+  this->attributes = attributes;
+  slots.clear();
+  count = 0;
+}
+
+void VertexTable::Reserve(const size_t count) {
+  while (count * 4 > slots.size() * 3) {
+    Grow();
+  }
+}
+
+void VertexTable::Insert(const uint32_t hash, const int index) {
+  if ((count + 1) * 4 > slots.size() * 3) {
+    Grow();
+  }
+  const size_t mask = slots.size() - 1;
+  size_t slotIx = hash & mask;
+  while (slots[slotIx].index >= 0) {
+    slotIx = (slotIx + 1) & mask;
+  }
+  slots[slotIx] = {hash, index};
+  count++;
+}
+
+void VertexTable::Grow() {
+  std::vector<Slot> oldSlots;
+  oldSlots.swap(slots);
+  slots.assign(std::max(oldSlots.size() * 2, (size_t)64), Slot{0, -1});
+  const size_t mask = slots.size() - 1;
+  for (const Slot& slot : oldSlots) {
+    if (slot.index >= 0) {
+      size_t slotIx = slot.hash & mask;
+      while (slots[slotIx].index >= 0) {
+        slotIx = (slotIx + 1) & mask;
+      }
+      slots[slotIx] = slot;
+    }
+  }
+}
+
 bool RawVertex::operator==(const RawVertex& other) const {
   return (position == other.position) && (normal == other.normal) && (tangent == other.tangent) &&
       (binormal == other.binormal) && (color == other.color) && (uv0 == other.uv0) &&
       (uv1 == other.uv1) && (jointIndices == other.jointIndices) &&
       (jointWeights == other.jointWeights) && (polarityUv0 == other.polarityUv0) &&
-      (blendSurfaceIx == other.blendSurfaceIx) && (blends == other.blends);
+      (blendSurfaceIx == other.blendSurfaceIx);
 }
 
 size_t RawVertex::Difference(const RawVertex& other) const {
@@ -75,20 +148,204 @@ size_t RawVertex::Difference(const RawVertex& other) const {
   return attributes;
 }
 
+// Call visit(array, member) for each attribute array selected by a RawVertexAttribute bitfield,
+// along with the RawVertex member it stores.
+template <typename _streams_, typename _visitor_>
+static void
+VisitAttributeStreams(_streams_& streams, const int attributes, const _visitor_& visit) {
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_POSITION) != 0) {
+    visit(streams.position, &RawVertex::position);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_NORMAL) != 0) {
+    visit(streams.normal, &RawVertex::normal);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_TANGENT) != 0) {
+    visit(streams.tangent, &RawVertex::tangent);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_BINORMAL) != 0) {
+    visit(streams.binormal, &RawVertex::binormal);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_COLOR) != 0) {
+    visit(streams.color, &RawVertex::color);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_UV0) != 0) {
+    visit(streams.uv0, &RawVertex::uv0);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_UV1) != 0) {
+    visit(streams.uv1, &RawVertex::uv1);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_JOINT_INDICES) != 0) {
+    visit(streams.jointIndices, &RawVertex::jointIndices);
+  }
+  if ((attributes & RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS) != 0) {
+    visit(streams.jointWeights, &RawVertex::jointWeights);
+  }
+}
+
+void RawVertexStreams::Allocate(const int attributes) {
+  const RawVertex defaultVertex;
+  const size_t count = Count();
+  VisitAttributeStreams(*this, attributes, [&](auto& stream, const auto member) {
+    if (stream.size() < count) {
+      stream.resize(count, defaultVertex.*member);
+    }
+  });
+}
+
+void RawVertexStreams::Append(const RawVertex& vertex, const int attributes) {
+  VisitAttributeStreams(*this, attributes, [&](auto& stream, const auto member) {
+    stream.push_back(vertex.*member);
+  });
+  polarityUv0.push_back(vertex.polarityUv0 ? 1 : 0);
+}
+
+RawVertex RawVertexStreams::Get(const int index, const int attributes) const {
+  RawVertex vertex;
+  VisitAttributeStreams(*this, attributes, [&](const auto& stream, const auto member) {
+    vertex.*member = stream[index];
+  });
+  vertex.polarityUv0 = polarityUv0[index] != 0;
+  vertex.blendSurfaceIx = blendSurfaceIx.empty() ? -1 : blendSurfaceIx[index];
+  return vertex;
+}
+
+static RawBlendVertex GetBlendDelta(const RawBlendDeltas& deltas, const int row) {
+  RawBlendVertex blendVertex;
+  blendVertex.position = deltas.positions[row];
+  if (!deltas.normals.empty()) {
+    blendVertex.normal = deltas.normals[row];
+  }
+  if (!deltas.tangents.empty()) {
+    blendVertex.tangent = deltas.tangents[row];
+  }
+  return blendVertex;
+}
+
 RawModel::RawModel() : vertexAttributes(0) {}
 
 void RawModel::AddVertexAttribute(const RawVertexAttribute attrib) {
   vertexAttributes |= attrib;
+  streams.Allocate(vertexAttributes);
 }
 
 int RawModel::AddVertex(const RawVertex& vertex) {
-  auto it = vertexHash.find(vertex);
-  if (it != vertexHash.end()) {
-    return it->second;
+  static const std::vector<RawBlendVertex> noBlends;
+  return AddVertex(vertex, noBlends);
+}
+
+int RawModel::AddVertex(const RawVertex& vertex, const std::vector<RawBlendVertex>& blends) {
+  if (vertexHash.GetCount() != streams.Count() ||
+      (vertexAttributes & ~vertexHash.GetAttributes()) != 0) {
+    // the table went stale, or a new attribute joined the model and the hash must cover it
+    RehashVertices();
+  }
+  const int newIndex = (int)streams.Count();
+  const int index = vertexHash.FindOrInsert(
+      VertexTable::Hash(vertex, vertexHash.GetAttributes()), newIndex, [&](const int other) {
+        return IsSameVertex(other, vertex, blends);
+      });
+  if (index != newIndex) {
+    return index;
+  }
+  streams.Append(vertex, vertexAttributes);
+
+  if (vertex.blendSurfaceIx >= 0 || !streams.blendSurfaceIx.empty()) {
+    int row = -1;
+    if (vertex.blendSurfaceIx >= 0) {
+      assert(blends.size() == surfaces[vertex.blendSurfaceIx].blendChannels.size());
+      if (blendDeltas.size() < surfaces.size()) {
+        blendDeltas.resize(surfaces.size());
+      }
+      std::vector<RawBlendDeltas>& channels = blendDeltas[vertex.blendSurfaceIx];
+      channels.resize(blends.size());
+      for (size_t channelIx = 0; channelIx < blends.size(); channelIx++) {
+        const RawBlendChannel& channel = surfaces[vertex.blendSurfaceIx].blendChannels[channelIx];
+        RawBlendDeltas& deltas = channels[channelIx];
+        row = (int)deltas.positions.size();
+        deltas.positions.push_back(blends[channelIx].position);
+        if (channel.hasNormals) {
+          deltas.normals.push_back(blends[channelIx].normal);
+        }
+        if (channel.hasTangents) {
+          deltas.tangents.push_back(blends[channelIx].tangent);
+        }
+      }
+    }
+    streams.blendSurfaceIx.resize(newIndex, -1);
+    streams.blendRow.resize(newIndex, -1);
+    streams.blendSurfaceIx.push_back(vertex.blendSurfaceIx);
+    streams.blendRow.push_back(row);
+  }
+  return index;
+}
+
+bool RawModel::IsSameVertex(
+    const int index,
+    const RawVertex& vertex,
+    const std::vector<RawBlendVertex>& blends) const {
+  const int blendSurfaceIx = streams.blendSurfaceIx.empty() ? -1 : streams.blendSurfaceIx[index];
+  if (blendSurfaceIx != vertex.blendSurfaceIx ||
+      (streams.polarityUv0[index] != 0) != vertex.polarityUv0) {
+    return false;
+  }
+  // compare bytes rather than floats, so that a NaN still matches itself
+  bool same = true;
+  VisitAttributeStreams(streams, vertexAttributes, [&](const auto& stream, const auto member) {
+    same = same && memcmp(&stream[index], &(vertex.*member), sizeof(stream[index])) == 0;
+  });
+  if (!same || blendSurfaceIx < 0) {
+    return same;
+  }
+  const std::vector<RawBlendDeltas>& channels = blendDeltas[blendSurfaceIx];
+  const int row = streams.blendRow[index];
+  for (size_t channelIx = 0; channelIx < channels.size(); channelIx++) {
+    const RawBlendVertex stored = GetBlendDelta(channels[channelIx], row);
+    if (memcmp(&stored.position, &blends[channelIx].position, sizeof(Vec3f)) != 0 ||
+        (!channels[channelIx].normals.empty() &&
+         memcmp(&stored.normal, &blends[channelIx].normal, sizeof(Vec3f)) != 0) ||
+        (!channels[channelIx].tangents.empty() &&
+         memcmp(&stored.tangent, &blends[channelIx].tangent, sizeof(Vec3f)) != 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RawModel::IsSameVertex(const int index, const int otherIndex, const int attributes) const {
+  const RawVertex vertex = streams.Get(index, attributes);
+  const RawVertex other = streams.Get(otherIndex, attributes);
+  if (vertex.blendSurfaceIx != other.blendSurfaceIx || vertex.polarityUv0 != other.polarityUv0) {
+    return false;
+  }
+  bool same = true;
+  VisitAttributeStreams(streams, attributes, [&](const auto& stream, const auto) {
+    same = same && memcmp(&stream[index], &stream[otherIndex], sizeof(stream[index])) == 0;
+  });
+  if (same && vertex.blendSurfaceIx >= 0) {
+    for (int channelIx = 0; channelIx < (int)blendDeltas[vertex.blendSurfaceIx].size();
+         channelIx++) {
+      same = same && GetBlendVertex(index, channelIx) == GetBlendVertex(otherIndex, channelIx);
+    }
   }
-  vertexHash.emplace(vertex, (int)vertices.size());
-  vertices.push_back(vertex);
-  return (int)vertices.size() - 1;
+  return same;
+}
+
+void RawModel::RehashVertices() {
+  vertexHash.Clear(vertexHash.GetAttributes() | vertexAttributes);
+  vertexHash.Reserve(streams.Count());
+  for (size_t i = 0; i < streams.Count(); i++) {
+    vertexHash.Insert(
+        VertexTable::Hash(streams.Get((int)i, vertexAttributes), vertexHash.GetAttributes()),
+        (int)i);
+  }
+}
+
+RawBlendVertex RawModel::GetBlendVertex(const int index, const int channelIx) const {
+  const int blendSurfaceIx = streams.blendSurfaceIx.empty() ? -1 : streams.blendSurfaceIx[index];
+  if (blendSurfaceIx < 0 || channelIx >= (int)blendDeltas[blendSurfaceIx].size()) {
+    return RawBlendVertex();
+  }
+  return GetBlendDelta(blendDeltas[blendSurfaceIx][channelIx], streams.blendRow[index]);
 }
 
 int RawModel::AddTriangle(
@@ -102,6 +359,35 @@ int RawModel::AddTriangle(
   return (int)triangles.size() - 1;
 }
 
+// Hash exactly what AddTexture() compares, case-insensitively where it does.
+static size_t HashTexture(
+    const std::string& name,
+    const std::string& fileLocation,
+    const RawTextureUsage usage) {
+  size_t seed = HashCombine(0, (int)usage);
+  seed = HashCombine(seed, StringUtils::HashNoCase(fileLocation));
+  return HashCombine(seed, StringUtils::HashNoCase(name));
+}
+
+// Hash exactly what AddMaterial() compares.
+static size_t HashMaterial(
+    const char* name,
+    const RawMaterialType materialType,
+    const RawMatProps& materialInfo,
+    const int textures[RAW_TEXTURE_USAGE_MAX],
+    const std::vector<std::string>& userProperties) {
+  size_t seed = std::hash<std::string_view>()(name);
+  seed = HashCombine(seed, (int)materialType);
+  seed = HashCombine(seed, materialInfo.Hash());
+  for (int i = 0; i < RAW_TEXTURE_USAGE_MAX; i++) {
+    seed = HashCombine(seed, textures[i]);
+  }
+  for (const auto& userProperty : userProperties) {
+    seed = HashCombine(seed, userProperty);
+  }
+  return seed;
+}
+
 int RawModel::AddTexture(
     const std::string& name,
     const std::string& fileName,
@@ -110,12 +396,15 @@ int RawModel::AddTexture(
   if (name.empty()) {
     return -1;
   }
-  for (size_t i = 0; i < textures.size(); i++) {
+  const size_t hash = HashTexture(name, fileLocation, usage);
+  const auto candidates = textureIndexByHash.equal_range(hash);
+  for (auto it = candidates.first; it != candidates.second; ++it) {
+    const RawTexture& texture = textures[it->second];
     // we allocate the struct even if the implementing image file is missing
-    if (textures[i].usage == usage &&
-        StringUtils::CompareNoCase(textures[i].fileLocation, fileLocation) == 0 &&
-        StringUtils::CompareNoCase(textures[i].name, name) == 0) {
-      return (int)i;
+    if (texture.usage == usage &&
+        StringUtils::CompareNoCase(texture.fileLocation, fileLocation) == 0 &&
+        StringUtils::CompareNoCase(texture.name, name) == 0) {
+      return it->second;
     }
   }
 
@@ -135,6 +424,7 @@ int RawModel::AddTexture(
   texture.fileName = fileName;
   texture.fileLocation = fileLocation;
   textures.emplace_back(texture);
+  textureIndexByHash.emplace(hash, (int)textures.size() - 1);
   return (int)textures.size() - 1;
 }
 
@@ -155,7 +445,10 @@ int RawModel::AddMaterial(
     const int textures[RAW_TEXTURE_USAGE_MAX],
     std::shared_ptr<RawMatProps> materialInfo,
     const std::vector<std::string>& userProperties) {
-  for (size_t i = 0; i < materials.size(); i++) {
+  const size_t hash = HashMaterial(name, materialType, *materialInfo, textures, userProperties);
+  const auto candidates = materialIndexByHash.equal_range(hash);
+  for (auto it = candidates.first; it != candidates.second; ++it) {
+    const size_t i = it->second;
     if (materials[i].name != name) {
       continue;
     }
@@ -193,6 +486,7 @@ int RawModel::AddMaterial(
   }
 
   materials.emplace_back(material);
+  materialIndexByHash.emplace(hash, (int)materials.size() - 1);
 
   return (int)materials.size() - 1;
 }
@@ -204,7 +498,10 @@ int RawModel::AddLight(
     const float intensity,
     const float innerConeAngle,
     const float outerConeAngle) {
-  for (size_t i = 0; i < lights.size(); i++) {
+  const size_t hash = HashCombine(std::hash<std::string_view>()(name), (int)lightType);
+  const auto candidates = lightIndexByHash.equal_range(hash);
+  for (auto it = candidates.first; it != candidates.second; ++it) {
+    const size_t i = it->second;
     if (lights[i].name != name || lights[i].type != lightType) {
       continue;
     }
@@ -226,6 +523,7 @@ int RawModel::AddLight(
       outerConeAngle,
   };
   lights.push_back(light);
+  lightIndexByHash.emplace(hash, (int)lights.size() - 1);
   return (int)lights.size() - 1;
 }
 
@@ -237,16 +535,16 @@ int RawModel::AddSurface(const RawSurface& surface) {
   }
 
   surfaces.emplace_back(surface);
+  surfaceIndexById.emplace(surface.id, (int)(surfaces.size() - 1));
   return (int)(surfaces.size() - 1);
 }
 
 int RawModel::AddSurface(const char* name, const long surfaceId) {
   assert(name[0] != '\0');
 
-  for (size_t i = 0; i < surfaces.size(); i++) {
-    if (surfaces[i].id == surfaceId) {
-      return (int)i;
-    }
+  const int existingIndex = GetSurfaceById(surfaceId);
+  if (existingIndex >= 0) {
+    return existingIndex;
   }
   RawSurface surface;
   surface.id = surfaceId;
@@ -255,6 +553,7 @@ int RawModel::AddSurface(const char* name, const long surfaceId) {
   surface.discrete = false;
 
   surfaces.emplace_back(surface);
+  surfaceIndexById.emplace(surfaceId, (int)(surfaces.size() - 1));
   return (int)(surfaces.size() - 1);
 }
 
@@ -264,13 +563,13 @@ int RawModel::AddAnimation(const RawAnimation& animation) {
 }
 
 int RawModel::AddNode(const RawNode& node) {
-  for (size_t i = 0; i < nodes.size(); i++) {
-    if (nodes[i].id == node.id) {
-      return (int)i;
-    }
+  const int existingIndex = GetNodeById(node.id);
+  if (existingIndex >= 0) {
+    return existingIndex;
   }
 
   nodes.emplace_back(node);
+  nodeIndexById.emplace(node.id, (int)nodes.size() - 1);
   return (int)nodes.size() - 1;
 }
 
@@ -317,10 +616,9 @@ int RawModel::AddCameraOrthographic(
 int RawModel::AddNode(const long id, const char* name, const long parentId) {
   assert(name[0] != '\0');
 
-  for (size_t i = 0; i < nodes.size(); i++) {
-    if (nodes[i].id == id) {
-      return (int)i;
-    }
+  const int existingIndex = GetNodeById(id);
+  if (existingIndex >= 0) {
+    return existingIndex;
   }
 
   RawNode joint;
@@ -335,28 +633,157 @@ int RawModel::AddNode(const long id, const char* name, const long parentId) {
   joint.scale = Vec3f(1, 1, 1);
 
   nodes.emplace_back(joint);
+  nodeIndexById.emplace(id, (int)nodes.size() - 1);
   return (int)nodes.size() - 1;
 }
 
+// Number the live entries densely and in order, mapping dead ones to -1; returns the live count.
+static int BuildRemap(const std::vector<bool>& live, std::vector<int>& remap) {
+  remap.assign(live.size(), -1);
+  int liveCount = 0;
+  for (size_t i = 0; i < live.size(); i++) {
+    if (live[i]) {
+      remap[i] = liveCount++;
+    }
+  }
+  return liveCount;
+}
+
+// Move each live element down to its remapped index, in place, and drop the rest.
+template <typename T>
+static void CompactInPlace(std::vector<T>& elements, const std::vector<int>& remap, int liveCount) {
+  for (size_t i = 0; i < elements.size(); i++) {
+    if (remap[i] >= 0 && remap[i] != (int)i) {
+      elements[remap[i]] = std::move(elements[i]);
+    }
+  }
+  elements.erase(elements.begin() + liveCount, elements.end());
+}
+
+int RawModel::MergeDuplicateSurfaces() {
+  std::vector<std::vector<int>> trianglesBySurface(surfaces.size());
+  for (int triIx = 0; triIx < (int)triangles.size(); triIx++) {
+    trianglesBySurface[triangles[triIx].surfaceIndex].push_back(triIx);
+  }
+  std::vector<uint32_t> vertexHashes(streams.Count());
+  for (size_t vertIx = 0; vertIx < vertexHashes.size(); vertIx++) {
+    vertexHashes[vertIx] =
+        VertexTable::Hash(streams.Get((int)vertIx, vertexAttributes), vertexAttributes);
+  }
+
+  // copies need not share vertices (e.g. their geometric transforms differed before baking), so
+  // the fingerprint and the comparison both go by vertex contents
+  const auto fingerprint = [&](const int surfaceIx) -> size_t {
+    const RawSurface& surface = surfaces[surfaceIx];
+    size_t seed = HashCombine(surface.jointIds.size(), trianglesBySurface[surfaceIx].size());
+    for (const long jointId : surface.jointIds) {
+      seed = HashCombine(seed, jointId);
+    }
+    for (const int triIx : trianglesBySurface[surfaceIx]) {
+      const RawTriangle& triangle = triangles[triIx];
+      seed = HashCombine(seed, triangle.materialIndex);
+      for (int corner = 0; corner < 3; corner++) {
+        seed = HashCombine(seed, vertexHashes[triangle.verts[corner]]);
+      }
+    }
+    return seed;
+  };
+  const auto isSame = [&](const int surfaceIx, const int otherIx) {
+    const RawSurface& surface = surfaces[surfaceIx];
+    const RawSurface& other = surfaces[otherIx];
+    if (surface.discrete != other.discrete || surface.jointIds != other.jointIds ||
+        surface.inverseBindMatrices != other.inverseBindMatrices ||
+        (!surface.jointIds.empty() && surface.skeletonRootId != other.skeletonRootId) ||
+        trianglesBySurface[surfaceIx].size() != trianglesBySurface[otherIx].size()) {
+      return false;
+    }
+    for (size_t ii = 0; ii < trianglesBySurface[surfaceIx].size(); ii++) {
+      const RawTriangle& triangle = triangles[trianglesBySurface[surfaceIx][ii]];
+      const RawTriangle& otherTriangle = triangles[trianglesBySurface[otherIx][ii]];
+      if (triangle.materialIndex != otherTriangle.materialIndex) {
+        return false;
+      }
+      for (int corner = 0; corner < 3; corner++) {
+        const int vertIx = triangle.verts[corner];
+        const int otherVertIx = otherTriangle.verts[corner];
+        if (vertIx != otherVertIx && !IsSameVertex(vertIx, otherVertIx, vertexAttributes)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  std::vector<int> survivors(surfaces.size());
+  std::unordered_multimap<size_t, int> surfaceIndexByFingerprint;
+  int mergedCount = 0;
+  for (int surfaceIx = 0; surfaceIx < (int)surfaces.size(); surfaceIx++) {
+    survivors[surfaceIx] = surfaceIx;
+    if (!surfaces[surfaceIx].blendChannels.empty() || trianglesBySurface[surfaceIx].empty()) {
+      continue;
+    }
+    const size_t hash = fingerprint(surfaceIx);
+    const auto range = surfaceIndexByFingerprint.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (isSame(it->second, surfaceIx)) {
+        survivors[surfaceIx] = it->second;
+        mergedCount++;
+        break;
+      }
+    }
+    if (survivors[surfaceIx] == surfaceIx) {
+      surfaceIndexByFingerprint.emplace(hash, surfaceIx);
+    }
+  }
+  if (mergedCount == 0) {
+    return 0;
+  }
+
+  for (auto& node : nodes) {
+    const int surfaceIx = (node.surfaceId != 0) ? GetSurfaceById(node.surfaceId) : -1;
+    if (surfaceIx >= 0 && survivors[surfaceIx] != surfaceIx) {
+      node.surfaceId = surfaces[survivors[surfaceIx]].id;
+    }
+  }
+  triangles.erase(
+      std::remove_if(
+          triangles.begin(),
+          triangles.end(),
+          [&](const RawTriangle& triangle) {
+            return survivors[triangle.surfaceIndex] != triangle.surfaceIndex;
+          }),
+      triangles.end());
+  if (verboseOutput) {
+    fmt::printf("Merged %d duplicate meshes.\n", mergedCount);
+  }
+  return mergedCount;
+}
+
 void RawModel::Condense() {
+  std::vector<int> remap;
+
   // Only keep surfaces that are referenced by one or more triangles.
+  std::vector<int> surfaceRemap;
   {
-    std::vector<RawSurface> oldSurfaces = surfaces;
-
-    surfaces.clear();
-
-    std::set<int> survivingSurfaceIds;
+    std::vector<bool> live(surfaces.size(), false);
+    for (const auto& triangle : triangles) {
+      live[triangle.surfaceIndex] = true;
+    }
+    const int liveCount = BuildRemap(live, surfaceRemap);
+    CompactInPlace(surfaces, surfaceRemap, liveCount);
+    blendDeltas.resize(surfaceRemap.size());
+    CompactInPlace(blendDeltas, surfaceRemap, liveCount);
     for (auto& triangle : triangles) {
-      const RawSurface& surface = oldSurfaces[triangle.surfaceIndex];
-      const int surfaceIndex = AddSurface(surface.name.c_str(), surface.id);
-      surfaces[surfaceIndex] = surface;
-      triangle.surfaceIndex = surfaceIndex;
-      survivingSurfaceIds.emplace(surface.id);
+      triangle.surfaceIndex = surfaceRemap[triangle.surfaceIndex];
+    }
+
+    surfaceIndexById.clear();
+    for (size_t i = 0; i < surfaces.size(); i++) {
+      surfaceIndexById.emplace(surfaces[i].id, (int)i);
     }
     // clear out references to meshes that no longer exist
     for (auto& node : nodes) {
-      if (node.surfaceId != 0 &&
-          survivingSurfaceIds.find(node.surfaceId) == survivingSurfaceIds.end()) {
+      if (node.surfaceId != 0 && GetSurfaceById(node.surfaceId) < 0) {
         node.surfaceId = 0;
       }
     }
@@ -364,53 +791,335 @@ void RawModel::Condense() {
 
   // Only keep materials that are referenced by one or more triangles.
   {
-    std::vector<RawMaterial> oldMaterials = materials;
-
-    materials.clear();
-
+    std::vector<bool> live(materials.size(), false);
+    for (const auto& triangle : triangles) {
+      if (triangle.materialIndex >= 0) {
+        live[triangle.materialIndex] = true;
+      }
+    }
+    CompactInPlace(materials, remap, BuildRemap(live, remap));
     for (auto& triangle : triangles) {
-      const RawMaterial& material = oldMaterials[triangle.materialIndex];
-      const int materialIndex = AddMaterial(material);
-      materials[materialIndex] = material;
-      triangle.materialIndex = materialIndex;
+      if (triangle.materialIndex >= 0) {
+        triangle.materialIndex = remap[triangle.materialIndex];
+      }
     }
   }
 
   // Only keep textures that are referenced by one or more materials.
   {
-    std::vector<RawTexture> oldTextures = textures;
-
-    textures.clear();
-
+    std::vector<bool> live(textures.size(), false);
+    for (const auto& material : materials) {
+      for (int j = 0; j < RAW_TEXTURE_USAGE_MAX; j++) {
+        if (material.textures[j] >= 0) {
+          live[material.textures[j]] = true;
+        }
+      }
+    }
+    CompactInPlace(textures, remap, BuildRemap(live, remap));
     for (auto& material : materials) {
       for (int j = 0; j < RAW_TEXTURE_USAGE_MAX; j++) {
         if (material.textures[j] >= 0) {
-          const RawTexture& texture = oldTextures[material.textures[j]];
-          const int textureIndex =
-              AddTexture(texture.name, texture.fileName, texture.fileLocation, texture.usage);
-          textures[textureIndex] = texture;
-          material.textures[j] = textureIndex;
+          material.textures[j] = remap[material.textures[j]];
         }
       }
     }
+
+    textureIndexByHash.clear();
+    for (size_t i = 0; i < textures.size(); i++) {
+      textureIndexByHash.emplace(
+          HashTexture(textures[i].name, textures[i].fileLocation, textures[i].usage), (int)i);
+    }
+    // the texture indices are part of each material's key
+    RehashMaterials();
   }
 
   // Only keep vertices that are referenced by one or more triangles.
   {
-    std::vector<RawVertex> oldVertices = vertices;
-
-    vertexHash.clear();
-    vertices.clear();
-
+    std::vector<bool> live(streams.Count(), false);
+    for (const auto& triangle : triangles) {
+      for (int j = 0; j < 3; j++) {
+        live[triangle.verts[j]] = true;
+      }
+    }
+    const int liveCount = BuildRemap(live, remap);
+    VisitAttributeStreams(streams, vertexAttributes, [&](auto& stream, const auto) {
+      CompactInPlace(stream, remap, liveCount);
+    });
+    CompactInPlace(streams.polarityUv0, remap, liveCount);
     for (auto& triangle : triangles) {
       for (int j = 0; j < 3; j++) {
-        triangle.verts[j] = AddVertex(oldVertices[triangle.verts[j]]);
+        triangle.verts[j] = remap[triangle.verts[j]];
       }
     }
+
+    if (!streams.blendSurfaceIx.empty()) {
+      CompactInPlace(streams.blendSurfaceIx, remap, liveCount);
+      CompactInPlace(streams.blendRow, remap, liveCount);
+      // Rows were handed out in vertex order, so walking the surviving vertices in order packs
+      // each surface's rows down without overwriting any that are still to be moved.
+      std::vector<int> rowCounts(surfaces.size(), 0);
+      for (int vertIx = 0; vertIx < liveCount; vertIx++) {
+        int& blendSurfaceIx = streams.blendSurfaceIx[vertIx];
+        if (blendSurfaceIx < 0) {
+          continue;
+        }
+        blendSurfaceIx = surfaceRemap[blendSurfaceIx];
+        const int oldRow = streams.blendRow[vertIx];
+        const int newRow = rowCounts[blendSurfaceIx]++;
+        for (auto& deltas : blendDeltas[blendSurfaceIx]) {
+          deltas.positions[newRow] = deltas.positions[oldRow];
+          if (!deltas.normals.empty()) {
+            deltas.normals[newRow] = deltas.normals[oldRow];
+          }
+          if (!deltas.tangents.empty()) {
+            deltas.tangents[newRow] = deltas.tangents[oldRow];
+          }
+        }
+        streams.blendRow[vertIx] = newRow;
+      }
+      for (size_t surfaceIx = 0; surfaceIx < blendDeltas.size(); surfaceIx++) {
+        for (auto& deltas : blendDeltas[surfaceIx]) {
+          const size_t rowCount = rowCounts[surfaceIx];
+          deltas.positions.resize(rowCount);
+          deltas.normals.resize(std::min(deltas.normals.size(), rowCount));
+          deltas.tangents.resize(std::min(deltas.tangents.size(), rowCount));
+        }
+      }
+    }
+
+    // indices moved; the table is rebuilt if more vertices are ever added
+    vertexHash.Clear(vertexAttributes);
+  }
+}
+
+int RawModel::MergeStaticSurfaces() {
+  const int rootIx = GetNodeById(rootNodeId);
+  if (rootIx < 0) {
+    return 0;
+  }
+  std::vector<bool> animated(nodes.size(), false);
+  for (const auto& animation : animations) {
+    for (const auto& channel : animation.channels) {
+      animated[channel.nodeIndex] = true;
+    }
+  }
+
+  // the static nodes with a mesh to merge, and the transforms that take them into root space
+  std::vector<int> mergedNodes;
+  std::vector<Mat4f> transforms;
+  std::vector<int> referenceCounts(surfaces.size(), 0);
+  std::vector<int> mergedCounts(surfaces.size(), 0);
+  for (int nodeIx = 0; nodeIx < (int)nodes.size(); nodeIx++) {
+    const RawNode& node = nodes[nodeIx];
+    const int surfaceIx = (node.surfaceId != 0) ? GetSurfaceById(node.surfaceId) : -1;
+    if (surfaceIx < 0) {
+      continue;
+    }
+    referenceCounts[surfaceIx]++;
+    if (!surfaces[surfaceIx].jointIds.empty() || !surfaces[surfaceIx].blendChannels.empty() ||
+        !node.instances.empty()) {
+      continue;
+    }
+    // the root's own transform still applies, to the node that will hold the merged mesh
+    Mat4f transform(1.0f);
+    int ancestorIx = nodeIx;
+    while (ancestorIx >= 0 && ancestorIx != rootIx && !animated[ancestorIx]) {
+      const RawNode& ancestor = nodes[ancestorIx];
+      transform = glm::translate(Mat4f(1.0f), ancestor.translation) *
+          glm::mat4_cast(ancestor.rotation) * glm::scale(Mat4f(1.0f), ancestor.scale) * transform;
+      ancestorIx = GetNodeById(ancestor.parentId);
+    }
+    if (ancestorIx == rootIx && !animated[rootIx]) {
+      mergedNodes.push_back(nodeIx);
+      transforms.push_back(transform);
+      mergedCounts[surfaceIx]++;
+    }
+  }
+  if (mergedNodes.size() < 2) {
+    return 0;
+  }
+
+  std::vector<std::vector<int>> trianglesBySurface(surfaces.size());
+  for (int triIx = 0; triIx < (int)triangles.size(); triIx++) {
+    trianglesBySurface[triangles[triIx].surfaceIndex].push_back(triIx);
+  }
+
+  long mergedId = rootNodeId;
+  for (const auto& node : nodes) {
+    mergedId = std::max(mergedId, node.id);
+  }
+  for (const auto& surface : surfaces) {
+    mergedId = std::max(mergedId, surface.id);
+  }
+  mergedId++;
+  const int mergedSurfaceIx = AddSurface("StaticMeshes", mergedId);
+  surfaces[mergedSurfaceIx].skeletonRootId = 0;
+
+  const auto transformDirection = [](const Mat4f& matrix, const Vec3f& direction) {
+    const Vec3f result = Vec3f(matrix * Vec4f(direction, 0.0f));
+    return (glm::dot(result, result) < FLT_MIN) ? direction : glm::normalize(result);
+  };
+
+  // each node's vertices are copied once, however many of its triangles share them
+  std::vector<int> mergedIndices(streams.Count(), -1);
+  std::vector<int> copiedVertices;
+  for (size_t ii = 0; ii < mergedNodes.size(); ii++) {
+    RawNode& node = nodes[mergedNodes[ii]];
+    const Mat4f& transform = transforms[ii];
+    const Mat4f normalTransform = glm::transpose(glm::inverse(transform));
+    const bool mirrored = glm::determinant(transform) < 0.0f;
+
+    for (const int vertIx : copiedVertices) {
+      mergedIndices[vertIx] = -1;
+    }
+    copiedVertices.clear();
+    for (const int triIx : trianglesBySurface[GetSurfaceById(node.surfaceId)]) {
+      const RawTriangle triangle = triangles[triIx];
+      int verts[3];
+      for (int corner = 0; corner < 3; corner++) {
+        const int vertIx = triangle.verts[corner];
+        if (mergedIndices[vertIx] < 0) {
+          RawVertex vertex = streams.Get(vertIx, vertexAttributes);
+          vertex.position = Vec3f(transform * Vec4f(vertex.position, 1.0f));
+          if ((vertexAttributes & RAW_VERTEX_ATTRIBUTE_NORMAL) != 0) {
+            vertex.normal = transformDirection(normalTransform, vertex.normal);
+          }
+          if ((vertexAttributes & RAW_VERTEX_ATTRIBUTE_BINORMAL) != 0) {
+            vertex.binormal = transformDirection(transform, vertex.binormal);
+          }
+          if ((vertexAttributes & RAW_VERTEX_ATTRIBUTE_TANGENT) != 0) {
+            // a mirroring transform flips the handedness of the tangent frame
+            vertex.tangent = Vec4f(
+                transformDirection(transform, Vec3f(vertex.tangent)),
+                mirrored ? -vertex.tangent.w : vertex.tangent.w);
+          }
+          mergedIndices[vertIx] = AddVertex(vertex);
+          copiedVertices.push_back(vertIx);
+          surfaces[mergedSurfaceIx].bounds.AddPoint(vertex.position);
+        }
+        verts[corner] = mergedIndices[vertIx];
+      }
+      if (mirrored) {
+        std::swap(verts[1], verts[2]);
+      }
+      AddTriangle(verts[0], verts[1], verts[2], triangle.materialIndex, mergedSurfaceIx);
+    }
+    node.surfaceId = 0;
+  }
+
+  // drop the originals that no node is left to use
+  triangles.erase(
+      std::remove_if(
+          triangles.begin(),
+          triangles.end(),
+          [&](const RawTriangle& triangle) {
+            return triangle.surfaceIndex != mergedSurfaceIx &&
+                mergedCounts[triangle.surfaceIndex] == referenceCounts[triangle.surfaceIndex];
+          }),
+      triangles.end());
+
+  RawNode mergedNode;
+  mergedNode.isJoint = false;
+  mergedNode.id = mergedId;
+  mergedNode.name = "StaticMeshes";
+  mergedNode.parentId = rootNodeId;
+  mergedNode.translation = Vec3f(0.0f);
+  mergedNode.rotation = Quatf(1.0f, 0.0f, 0.0f, 0.0f);
+  mergedNode.scale = Vec3f(1.0f);
+  mergedNode.surfaceId = mergedId;
+  mergedNode.lightIx = -1;
+  AddNode(mergedNode);
+  nodes[rootIx].childIds.push_back(mergedId);
+
+  if (verboseOutput) {
+    fmt::printf("Merged %lu static meshes into one.\n", mergedNodes.size());
+  }
+  return (int)mergedNodes.size();
+}
+
+int RawModel::FoldInstances() {
+  // nodes that animations or cameras refer to stay where they are
+  std::vector<bool> pinned(nodes.size(), false);
+  for (const auto& animation : animations) {
+    for (const auto& channel : animation.channels) {
+      pinned[channel.nodeIndex] = true;
+    }
+  }
+  for (const auto& camera : cameras) {
+    const int nodeIx = GetNodeById(camera.nodeId);
+    if (nodeIx >= 0) {
+      pinned[nodeIx] = true;
+    }
   }
+  const auto canFold = [&](const int nodeIx) {
+    const RawNode& node = nodes[nodeIx];
+    if (pinned[nodeIx] || node.isJoint || node.surfaceId == 0 || !node.childIds.empty() ||
+        node.lightIx >= 0 || !node.userProperties.empty() || !node.instances.empty()) {
+      return false;
+    }
+    const int surfaceIx = GetSurfaceById(node.surfaceId);
+    return surfaceIx >= 0 && surfaces[surfaceIx].jointIds.empty() &&
+        surfaces[surfaceIx].blendChannels.empty();
+  };
+
+  std::vector<bool> live(nodes.size(), true);
+  int foldedCount = 0;
+  for (auto& parent : nodes) {
+    // the foldable children of this node, by surface, in order
+    std::map<long, std::vector<int>> childrenBySurfaceId;
+    for (const long childId : parent.childIds) {
+      const int childIx = GetNodeById(childId);
+      if (childIx >= 0 && canFold(childIx)) {
+        childrenBySurfaceId[nodes[childIx].surfaceId].push_back(childIx);
+      }
+    }
+    for (const auto& entry : childrenBySurfaceId) {
+      if (entry.second.size() < 2) {
+        continue;
+      }
+      RawNode& holder = nodes[entry.second[0]];
+      for (const int childIx : entry.second) {
+        const RawNode& child = nodes[childIx];
+        holder.instances.push_back({child.translation, child.rotation, child.scale});
+        live[childIx] = (childIx == entry.second[0]);
+      }
+      holder.translation = Vec3f(0.0f);
+      holder.rotation = Quatf(1.0f, 0.0f, 0.0f, 0.0f);
+      holder.scale = Vec3f(1.0f);
+      foldedCount += (int)entry.second.size() - 1;
+    }
+    parent.childIds.erase(
+        std::remove_if(
+            parent.childIds.begin(),
+            parent.childIds.end(),
+            [&](const long childId) {
+              const int childIx = GetNodeById(childId);
+              return childIx >= 0 && !live[childIx];
+            }),
+        parent.childIds.end());
+  }
+  if (foldedCount == 0) {
+    return 0;
+  }
+
+  std::vector<int> remap;
+  CompactInPlace(nodes, remap, BuildRemap(live, remap));
+  nodeIndexById.clear();
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodeIndexById.emplace(nodes[i].id, (int)i);
+  }
+  for (auto& animation : animations) {
+    for (auto& channel : animation.channels) {
+      channel.nodeIndex = remap[channel.nodeIndex];
+    }
+  }
+  if (verboseOutput) {
+    fmt::printf("Folded %d nodes into instances.\n", foldedCount);
+  }
+  return foldedCount;
 }
 
-void RawModel::TransformGeometry(ComputeNormalsOption normals) {
+void RawModel::TransformGeometry(ComputeNormalsOption normals, ComputeTangentsOption tangents) {
   switch (normals) {
     case ComputeNormalsOption::NEVER:
       break;
@@ -422,7 +1131,6 @@ void RawModel::TransformGeometry(ComputeNormalsOption normals) {
     case ComputeNormalsOption::BROKEN:
     case ComputeNormalsOption::ALWAYS:
       size_t computedNormalsCount = this->CalculateNormals(normals == ComputeNormalsOption::BROKEN);
-      vertexAttributes |= RAW_VERTEX_ATTRIBUTE_NORMAL;
 
       if (verboseOutput) {
         if (normals == ComputeNormalsOption::BROKEN) {
@@ -435,23 +1143,28 @@ void RawModel::TransformGeometry(ComputeNormalsOption normals) {
       }
       break;
   }
-}
 
-void RawModel::TransformTextures(const std::vector<std::function<Vec2f(Vec2f)>>& transforms) {
-  for (auto& vertice : vertices) {
-    if ((vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV0) != 0) {
-      for (const auto& fun : transforms) {
-        vertice.uv0 = fun(vertice.uv0);
-      }
-    }
-    if ((vertexAttributes & RAW_VERTEX_ATTRIBUTE_UV1) != 0) {
-      for (const auto& fun : transforms) {
-        vertice.uv1 = fun(vertice.uv1);
-      }
+  // tangents are built on the final normals
+  if (tangents != ComputeTangentsOption::NEVER) {
+    const size_t computedTangentsCount =
+        this->CalculateTangents(tangents == ComputeTangentsOption::MISSING);
+    if (verboseOutput && computedTangentsCount > 0) {
+      fmt::printf("Generated %lu tangents.\n", computedTangentsCount);
     }
   }
 }
 
+void RawModel::TransformTextures(const UVTransform& transform) {
+  // the stored UVs change underneath the vertex table
+  vertexHash.Clear(vertexAttributes);
+  for (auto& uv : streams.uv0) {
+    uv = transform.Apply(uv);
+  }
+  for (auto& uv : streams.uv1) {
+    uv = transform.Apply(uv);
+  }
+}
+
 struct TriangleModelSortPos {
   static bool Compare(const RawTriangle& a, const RawTriangle& b) {
     if (a.materialIndex != b.materialIndex) {
@@ -476,19 +1189,54 @@ struct TriangleModelSortNeg {
   }
 };
 
-void RawModel::CreateMaterialModels(
-    std::vector<RawModel>& materialModels,
+// The attributes to keep for triangles of the given material, given the --keep-attribute mask.
+static int GetKeptAttributes(const int keepAttribs, const RawMaterial& material) {
+  if (keepAttribs == -1) {
+    return -1;
+  }
+  int keep = keepAttribs;
+  if ((keepAttribs & RAW_VERTEX_ATTRIBUTE_POSITION) != 0) {
+    keep |= RAW_VERTEX_ATTRIBUTE_JOINT_INDICES | RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS;
+  }
+  if ((keepAttribs & RAW_VERTEX_ATTRIBUTE_AUTO) != 0) {
+    keep |= RAW_VERTEX_ATTRIBUTE_POSITION;
+
+    if (material.textures[RAW_TEXTURE_USAGE_DIFFUSE] != -1) {
+      keep |= RAW_VERTEX_ATTRIBUTE_UV0;
+    }
+    if (material.textures[RAW_TEXTURE_USAGE_NORMAL] != -1) {
+      keep |= RAW_VERTEX_ATTRIBUTE_NORMAL | RAW_VERTEX_ATTRIBUTE_TANGENT |
+          RAW_VERTEX_ATTRIBUTE_BINORMAL | RAW_VERTEX_ATTRIBUTE_UV0;
+    }
+    if (material.textures[RAW_TEXTURE_USAGE_SPECULAR] != -1) {
+      keep |= RAW_VERTEX_ATTRIBUTE_NORMAL | RAW_VERTEX_ATTRIBUTE_UV0;
+    }
+    if (material.textures[RAW_TEXTURE_USAGE_EMISSIVE] != -1) {
+      keep |= RAW_VERTEX_ATTRIBUTE_UV1;
+    }
+  }
+  return keep;
+}
+
+void RawModel::CreatePrimitives(
+    std::vector<RawPrimitive>& primitives,
     bool shortIndices,
     const int keepAttribs,
     const bool forceDiscrete) const {
   // Sort all triangles based on material first, then surface, then first vertex index.
   std::vector<RawTriangle> sortedTriangles;
+  // sortedTriangles holds the opaque triangles, then from here on the transparent ones
+  size_t transparentBegin = triangles.size();
 
   bool invertedTransparencySort = true;
   if (invertedTransparencySort) {
     // Split the triangles into opaque and transparent triangles.
     std::vector<RawTriangle> opaqueTriangles;
     std::vector<RawTriangle> transparentTriangles;
+    const float defaultAlpha = RawVertex().color.w;
+    const auto vertexAlpha = [&](const int index) {
+      return streams.color.empty() ? defaultAlpha : streams.color[index].w;
+    };
     for (const auto& triangle : triangles) {
       const int materialIndex = triangle.materialIndex;
       if (materialIndex < 0) {
@@ -497,9 +1245,8 @@ void RawModel::CreateMaterialModels(
       }
       const int textureIndex = materials[materialIndex].textures[RAW_TEXTURE_USAGE_DIFFUSE];
       if (textureIndex < 0) {
-        if (vertices[triangle.verts[0]].color.w < 1.0f ||
-            vertices[triangle.verts[1]].color.w < 1.0f ||
-            vertices[triangle.verts[2]].color.w < 1.0f) {
+        if (vertexAlpha(triangle.verts[0]) < 1.0f || vertexAlpha(triangle.verts[1]) < 1.0f ||
+            vertexAlpha(triangle.verts[2]) < 1.0f) {
           transparentTriangles.push_back(triangle);
           continue;
         }
@@ -521,6 +1268,7 @@ void RawModel::CreateMaterialModels(
         transparentTriangles.begin(), transparentTriangles.end(), TriangleModelSortNeg::Compare);
 
     // Add the triangles to the sorted list.
+    transparentBegin = opaqueTriangles.size();
     for (const auto& opaqueTriangle : opaqueTriangles) {
       sortedTriangles.push_back(opaqueTriangle);
     }
@@ -532,146 +1280,138 @@ void RawModel::CreateMaterialModels(
     std::sort(sortedTriangles.begin(), sortedTriangles.end(), TriangleModelSortPos::Compare);
   }
 
-  // Overestimate the number of models that will be created to avoid massive reallocation.
+  // Overestimate the number of primitives that will be created to avoid massive reallocation.
   int discreteCount = 0;
   for (const auto& surface : surfaces) {
     discreteCount += surface.discrete ? 1 : 0;
   }
 
-  materialModels.clear();
-  materialModels.reserve(materials.size() + discreteCount);
+  primitives.clear();
+  primitives.reserve(materials.size() + discreteCount);
 
   const RawVertex defaultVertex;
+  // the local index of each model vertex, valid in the primitive named by localOwners
+  std::vector<int> localIndices(streams.Count(), -1);
+  std::vector<int> localOwners(streams.Count(), -1);
+  // when attributes are stripped, vertices that only differed in those collapse into one
+  VertexTable keptVertices;
+  int keep = vertexAttributes;
+
+  const auto finishPrimitive = [&](RawPrimitive& primitive) {
+    // the primitive carries the attributes whose values aren't all defaults
+    RawVertex differs;
+    VisitAttributeStreams(streams, keep, [&](const auto& stream, const auto member) {
+      for (const int vertIx : primitive.vertices) {
+        if (stream[vertIx] != defaultVertex.*member) {
+          differs.*member = stream[vertIx];
+          break;
+        }
+      }
+    });
+    primitive.vertexAttributes = (int)differs.Difference(defaultVertex);
+
+    primitive.bounds.Clear();
+    for (const int vertIx : primitive.vertices) {
+      primitive.bounds.AddPoint(
+          (keep & RAW_VERTEX_ATTRIBUTE_POSITION) != 0 ? streams.position[vertIx]
+                                                       : defaultVertex.position);
+    }
+  };
 
-  // Create a separate model for each material.
-  RawModel* model;
+  // Create a separate primitive for each material.
+  RawPrimitive* primitive = nullptr;
   for (size_t i = 0; i < sortedTriangles.size(); i++) {
-    if (sortedTriangles[i].materialIndex < 0 || sortedTriangles[i].surfaceIndex < 0) {
+    const RawTriangle& triangle = sortedTriangles[i];
+    if (triangle.materialIndex < 0 || triangle.surfaceIndex < 0) {
       continue;
     }
 
-    if (i == 0 || (shortIndices && model->GetVertexCount() >= 0xFFFE) ||
-        sortedTriangles[i].materialIndex != sortedTriangles[i - 1].materialIndex ||
-        (sortedTriangles[i].surfaceIndex != sortedTriangles[i - 1].surfaceIndex &&
-         (forceDiscrete || surfaces[sortedTriangles[i].surfaceIndex].discrete ||
+    if (primitive == nullptr || (shortIndices && primitive->GetVertexCount() >= 0xFFFE) ||
+        primitive->transparent != (i >= transparentBegin) ||
+        triangle.materialIndex != sortedTriangles[i - 1].materialIndex ||
+        (triangle.surfaceIndex != sortedTriangles[i - 1].surfaceIndex &&
+         (forceDiscrete || surfaces[triangle.surfaceIndex].discrete ||
           surfaces[sortedTriangles[i - 1].surfaceIndex].discrete))) {
-      materialModels.resize(materialModels.size() + 1);
-      model = &materialModels[materialModels.size() - 1];
-    }
-
-    // FIXME: will have to unlink from the nodes, transform both surfaces into a
-    // common space, and reparent to a new node with appropriate transform.
-
-    const int prevSurfaceCount = model->GetSurfaceCount();
-    const int materialIndex = model->AddMaterial(materials[sortedTriangles[i].materialIndex]);
-    const int surfaceIndex = model->AddSurface(surfaces[sortedTriangles[i].surfaceIndex]);
-    RawSurface& rawSurface = model->GetSurface(surfaceIndex);
-
-    if (model->GetSurfaceCount() > prevSurfaceCount) {
-      const std::vector<long>& jointIds = surfaces[sortedTriangles[i].surfaceIndex].jointIds;
-      for (const auto& jointId : jointIds) {
-        const int nodeIndex = GetNodeById(jointId);
-        assert(nodeIndex != -1);
-        model->AddNode(GetNode(nodeIndex));
+      if (primitive != nullptr) {
+        finishPrimitive(*primitive);
       }
-      rawSurface.bounds.Clear();
+      primitives.resize(primitives.size() + 1);
+      primitive = &primitives[primitives.size() - 1];
+      primitive->materialIndex = triangle.materialIndex;
+      primitive->surfaceIndex = triangle.surfaceIndex;
+      // opaque and transparent triangles never share a primitive, even of the same material
+      primitive->transparent = (i >= transparentBegin);
+
+      keep = GetKeptAttributes(keepAttribs, materials[triangle.materialIndex]) & vertexAttributes;
+      keptVertices.Clear(keep);
     }
 
-    int verts[3];
     for (int j = 0; j < 3; j++) {
-      RawVertex vertex = vertices[sortedTriangles[i].verts[j]];
-
-      if (keepAttribs != -1) {
-        int keep = keepAttribs;
-        if ((keepAttribs & RAW_VERTEX_ATTRIBUTE_POSITION) != 0) {
-          keep |= RAW_VERTEX_ATTRIBUTE_JOINT_INDICES | RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS;
-        }
-        if ((keepAttribs & RAW_VERTEX_ATTRIBUTE_AUTO) != 0) {
-          keep |= RAW_VERTEX_ATTRIBUTE_POSITION;
-
-          const RawMaterial& mat = model->GetMaterial(materialIndex);
-          if (mat.textures[RAW_TEXTURE_USAGE_DIFFUSE] != -1) {
-            keep |= RAW_VERTEX_ATTRIBUTE_UV0;
-          }
-          if (mat.textures[RAW_TEXTURE_USAGE_NORMAL] != -1) {
-            keep |= RAW_VERTEX_ATTRIBUTE_NORMAL | RAW_VERTEX_ATTRIBUTE_TANGENT |
-                RAW_VERTEX_ATTRIBUTE_BINORMAL | RAW_VERTEX_ATTRIBUTE_UV0;
-          }
-          if (mat.textures[RAW_TEXTURE_USAGE_SPECULAR] != -1) {
-            keep |= RAW_VERTEX_ATTRIBUTE_NORMAL | RAW_VERTEX_ATTRIBUTE_UV0;
-          }
-          if (mat.textures[RAW_TEXTURE_USAGE_EMISSIVE] != -1) {
-            keep |= RAW_VERTEX_ATTRIBUTE_UV1;
-          }
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_POSITION) == 0) {
-          vertex.position = defaultVertex.position;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_NORMAL) == 0) {
-          vertex.normal = defaultVertex.normal;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_TANGENT) == 0) {
-          vertex.tangent = defaultVertex.tangent;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_BINORMAL) == 0) {
-          vertex.binormal = defaultVertex.binormal;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_COLOR) == 0) {
-          vertex.color = defaultVertex.color;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_UV0) == 0) {
-          vertex.uv0 = defaultVertex.uv0;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_UV1) == 0) {
-          vertex.uv1 = defaultVertex.uv1;
-        }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_JOINT_INDICES) == 0) {
-          vertex.jointIndices = defaultVertex.jointIndices;
+      const int vertIx = triangle.verts[j];
+      const int owner = (int)primitives.size() - 1;
+      int localIx = localIndices[vertIx];
+      if (localOwners[vertIx] != owner) {
+        const int newLocalIx = primitive->GetVertexCount();
+        localIx = newLocalIx;
+        if (keep != vertexAttributes) {
+          localIx = keptVertices.FindOrInsert(
+              VertexTable::Hash(streams.Get(vertIx, keep), keep),
+              newLocalIx,
+              [&](const int other) {
+                return IsSameVertex(primitive->vertices[other], vertIx, keep);
+              });
         }
-        if ((keep & RAW_VERTEX_ATTRIBUTE_JOINT_WEIGHTS) == 0) {
-          vertex.jointWeights = defaultVertex.jointWeights;
+        if (localIx == newLocalIx) {
+          primitive->vertices.push_back(vertIx);
         }
+        localIndices[vertIx] = localIx;
+        localOwners[vertIx] = owner;
       }
-
-      verts[j] = model->AddVertex(vertex);
-      model->vertexAttributes |= vertex.Difference(defaultVertex);
-
-      rawSurface.bounds.AddPoint(vertex.position);
+      primitive->indices.push_back((uint32_t)localIx);
     }
+  }
+  if (primitive != nullptr) {
+    finishPrimitive(*primitive);
+  }
+}
 
-    model->AddTriangle(verts[0], verts[1], verts[2], materialIndex, surfaceIndex);
+void RawModel::RehashMaterials() {
+  materialIndexByHash.clear();
+  for (size_t i = 0; i < materials.size(); i++) {
+    const RawMaterial& material = materials[i];
+    materialIndexByHash.emplace(
+        HashMaterial(
+            material.name.c_str(),
+            material.type,
+            *material.info,
+            material.textures,
+            material.userProperties),
+        (int)i);
   }
 }
 
 int RawModel::GetNodeById(const long nodeId) const {
-  for (size_t i = 0; i < nodes.size(); i++) {
-    if (nodes[i].id == nodeId) {
-      return (int)i;
-    }
-  }
-  return -1;
+  const auto it = nodeIndexById.find(nodeId);
+  return it != nodeIndexById.end() ? it->second : -1;
 }
 
 int RawModel::GetSurfaceById(const long surfaceId) const {
-  for (size_t i = 0; i < surfaces.size(); i++) {
-    if (surfaces[i].id == surfaceId) {
-      return (int)i;
-    }
-  }
-  return -1;
+  const auto it = surfaceIndexById.find(surfaceId);
+  return it != surfaceIndexById.end() ? it->second : -1;
 }
 
 Vec3f RawModel::getFaceNormal(int verts[3]) const {
-  const float l0 = glm::dot(vertices[verts[1]].position - vertices[verts[0]].position,
-                            vertices[verts[1]].position - vertices[verts[0]].position);
-  const float l1 = glm::dot(vertices[verts[2]].position - vertices[verts[1]].position,
-                            vertices[verts[2]].position - vertices[verts[1]].position);
-  const float l2 = glm::dot(vertices[verts[0]].position - vertices[verts[2]].position,
-                            vertices[verts[0]].position - vertices[verts[2]].position);
+  const std::vector<Vec3f>& positions = streams.position;
+  const float l0 = glm::dot(positions[verts[1]] - positions[verts[0]],
+                            positions[verts[1]] - positions[verts[0]]);
+  const float l1 = glm::dot(positions[verts[2]] - positions[verts[1]],
+                            positions[verts[2]] - positions[verts[1]]);
+  const float l2 = glm::dot(positions[verts[0]] - positions[verts[2]],
+                            positions[verts[0]] - positions[verts[2]]);
   const int index = (l0 > l1) ? (l0 > l2 ? 2 : 1) : (l1 > l2 ? 0 : 1);
 
-  const Vec3f e0 = vertices[verts[(index + 1) % 3]].position - vertices[verts[index]].position;
-  const Vec3f e1 = vertices[verts[(index + 2) % 3]].position - vertices[verts[index]].position;
+  const Vec3f e0 = positions[verts[(index + 1) % 3]] - positions[verts[index]];
+  const Vec3f e1 = positions[verts[(index + 2) % 3]] - positions[verts[index]];
   if (glm::dot(e0, e0) < FLT_MIN || glm::dot(e1, e1) < FLT_MIN) {
     return Vec3f{0.0f};
   }
@@ -687,49 +1427,248 @@ Vec3f RawModel::getFaceNormal(int verts[3]) const {
 }
 
 size_t RawModel::CalculateNormals(bool onlyBroken) {
+  AddVertexAttribute(RAW_VERTEX_ATTRIBUTE_NORMAL);
+  // the stored normals change underneath the vertex table
+  vertexHash.Clear(vertexAttributes);
+
+  const std::vector<Vec3f>& positions = streams.position;
+  std::vector<Vec3f>& normals = streams.normal;
+  const size_t vertexCount = streams.Count();
+  const size_t triangleCount = triangles.size();
+
   Vec3f averagePos = Vec3f{0.0f};
-  std::set<int> brokenVerts;
-  for (int vertIx = 0; vertIx < vertices.size(); vertIx++) {
-    RawVertex& vertex = vertices[vertIx];
-    averagePos += (vertex.position / (float)vertices.size());
-    if (onlyBroken && (glm::dot(vertex.normal, vertex.normal) >= FLT_MIN)) {
-      continue;
-    }
-    vertex.normal = Vec3f{0.0f};
-    if (onlyBroken) {
-      brokenVerts.emplace(vertIx);
+  std::vector<uint8_t> recompute(vertexCount, 0);
+  size_t recomputeCount = 0;
+  for (size_t vertIx = 0; vertIx < vertexCount; vertIx++) {
+    averagePos += (positions[vertIx] / (float)vertexCount);
+    if (!onlyBroken || glm::dot(normals[vertIx], normals[vertIx]) < FLT_MIN) {
+      recompute[vertIx] = 1;
+      recomputeCount++;
     }
   }
 
-  for (auto& triangle : triangles) {
-    bool relevant = false;
+  // vertex -> triangle adjacency (CSR), listing each vertex's triangles in triangle order, so the
+  // gather below sums face normals in the same order no matter how the work is split up
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  std::vector<uint8_t> relevant(triangleCount, 0);
+  for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+    const RawTriangle& triangle = triangles[triIx];
     for (int vertIx : triangle.verts) {
-      relevant |= (brokenVerts.count(vertIx) > 0);
+      if (recompute[vertIx] != 0) {
+        relevant[triIx] = 1;
+        adjacencyOffsets[vertIx + 1]++;
+      }
+    }
+  }
+  for (size_t vertIx = 0; vertIx < vertexCount; vertIx++) {
+    adjacencyOffsets[vertIx + 1] += adjacencyOffsets[vertIx];
+  }
+  std::vector<uint32_t> adjacency(adjacencyOffsets[vertexCount]);
+  {
+    std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+      for (int vertIx : triangles[triIx].verts) {
+        if (recompute[vertIx] != 0) {
+          adjacency[cursor[vertIx]++] = (uint32_t)triIx;
+        }
+      }
     }
-    if (!relevant) {
+  }
+
+  // phase one: the weighted normal of each triangle that touches a vertex we recompute
+  std::vector<Vec3f> faceNormals(triangleCount);
+  ThreadUtils::ParallelFor(triangleCount, 4096, [&](const size_t begin, const size_t end) {
+    for (size_t triIx = begin; triIx < end; triIx++) {
+      if (relevant[triIx] != 0) {
+        faceNormals[triIx] = getFaceNormal(triangles[triIx].verts);
+      }
+    }
+  });
+
+  // phase two: each recomputed vertex gathers and normalizes the normals of its triangles
+  ThreadUtils::ParallelFor(vertexCount, 4096, [&](const size_t begin, const size_t end) {
+    for (size_t vertIx = begin; vertIx < end; vertIx++) {
+      if (recompute[vertIx] == 0) {
+        continue;
+      }
+      Vec3f normal = Vec3f{0.0f};
+      for (uint32_t adjIx = adjacencyOffsets[vertIx]; adjIx < adjacencyOffsets[vertIx + 1];
+           adjIx++) {
+        normal += faceNormals[adjacency[adjIx]];
+      }
+      if (glm::dot(normal, normal) < FLT_MIN) {
+        normal = positions[vertIx] - averagePos;
+        if (glm::dot(normal, normal) < FLT_MIN) {
+          normals[vertIx] = Vec3f{0.0f, 1.0f, 0.0f};
+          continue;
+        }
+      }
+      normals[vertIx] = glm::normalize(normal);
+    }
+  });
+  return recomputeCount;
+}
+
+// The triangles of one surface, as the MikkTSpace callbacks see them.
+struct TangentSpaceSurface {
+  const std::vector<RawTriangle>& triangles;
+  const uint32_t* triangleIndices;
+  int triangleCount;
+  const RawVertexStreams& streams;
+  std::vector<Vec4f>& cornerTangents; // three per triangle of the model
+};
+
+static int GetVertexIndex(const SMikkTSpaceContext* context, const int face, const int corner) {
+  const auto* surface = static_cast<const TangentSpaceSurface*>(context->m_pUserData);
+  return surface->triangles[surface->triangleIndices[face]].verts[corner];
+}
+
+static SMikkTSpaceInterface tangentSpaceInterface = {
+    [](const SMikkTSpaceContext* context) {
+      return static_cast<const TangentSpaceSurface*>(context->m_pUserData)->triangleCount;
+    },
+    [](const SMikkTSpaceContext*, const int) { return 3; },
+    [](const SMikkTSpaceContext* context, float position[], const int face, const int corner) {
+      const auto* surface = static_cast<const TangentSpaceSurface*>(context->m_pUserData);
+      const Vec3f& p = surface->streams.position[GetVertexIndex(context, face, corner)];
+      position[0] = p[0];
+      position[1] = p[1];
+      position[2] = p[2];
+    },
+    [](const SMikkTSpaceContext* context, float normal[], const int face, const int corner) {
+      const auto* surface = static_cast<const TangentSpaceSurface*>(context->m_pUserData);
+      const Vec3f& n = surface->streams.normal[GetVertexIndex(context, face, corner)];
+      normal[0] = n[0];
+      normal[1] = n[1];
+      normal[2] = n[2];
+    },
+    [](const SMikkTSpaceContext* context, float uv[], const int face, const int corner) {
+      const auto* surface = static_cast<const TangentSpaceSurface*>(context->m_pUserData);
+      const Vec2f& t = surface->streams.uv0[GetVertexIndex(context, face, corner)];
+      // glTF's v axis runs down the image, while normal maps have their green channel pointing up
+      uv[0] = t[0];
+      uv[1] = 1.0f - t[1];
+    },
+    [](const SMikkTSpaceContext* context,
+       const float tangent[],
+       const float sign,
+       const int face,
+       const int corner) {
+      auto* surface = static_cast<TangentSpaceSurface*>(context->m_pUserData);
+      surface->cornerTangents[surface->triangleIndices[face] * 3 + corner] =
+          Vec4f(tangent[0], tangent[1], tangent[2], sign);
+    },
+    nullptr};
+
+size_t RawModel::CalculateTangents(bool onlyMissing) {
+  const int required =
+      RAW_VERTEX_ATTRIBUTE_POSITION | RAW_VERTEX_ATTRIBUTE_NORMAL | RAW_VERTEX_ATTRIBUTE_UV0;
+  if ((vertexAttributes & required) != required) {
+    return 0;
+  }
+  const bool hadTangents = (vertexAttributes & RAW_VERTEX_ATTRIBUTE_TANGENT) != 0;
+
+  const size_t vertexCount = streams.Count();
+  const size_t triangleCount = triangles.size();
+  const size_t surfaceCount = surfaces.size();
+
+  // only triangles of normal-mapped materials take part, and only their vertices get tangents
+  std::vector<uint8_t> generate(vertexCount, 0);
+  std::vector<uint8_t> relevant(triangleCount, 0);
+  size_t generateCount = 0;
+  for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+    const RawTriangle& triangle = triangles[triIx];
+    if (triangle.materialIndex < 0 || triangle.surfaceIndex < 0 ||
+        materials[triangle.materialIndex].textures[RAW_TEXTURE_USAGE_NORMAL] == -1) {
       continue;
     }
-    Vec3f faceNormal = this->getFaceNormal(triangle.verts);
     for (int vertIx : triangle.verts) {
-      if (!onlyBroken || brokenVerts.count(vertIx) > 0) {
-        vertices[vertIx].normal += faceNormal;
+      if (generate[vertIx] == 0 &&
+          (!onlyMissing || !hadTangents ||
+           glm::dot(Vec3f(streams.tangent[vertIx]), Vec3f(streams.tangent[vertIx])) < FLT_MIN)) {
+        generate[vertIx] = 1;
+        generateCount++;
+      }
+      relevant[triIx] |= generate[vertIx];
+    }
+  }
+  if (generateCount == 0) {
+    return 0;
+  }
+
+  AddVertexAttribute(RAW_VERTEX_ATTRIBUTE_TANGENT);
+  // the stored tangents change underneath the vertex table
+  vertexHash.Clear(vertexAttributes);
+
+  // surface -> triangle lists (CSR), so each surface's triangles can be processed as one task
+  std::vector<uint32_t> surfaceOffsets(surfaceCount + 1, 0);
+  for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+    if (relevant[triIx] != 0) {
+      surfaceOffsets[triangles[triIx].surfaceIndex + 1]++;
+    }
+  }
+  for (size_t surfaceIx = 0; surfaceIx < surfaceCount; surfaceIx++) {
+    surfaceOffsets[surfaceIx + 1] += surfaceOffsets[surfaceIx];
+  }
+  std::vector<uint32_t> surfaceTriangles(surfaceOffsets[surfaceCount]);
+  {
+    std::vector<uint32_t> cursor(surfaceOffsets.begin(), surfaceOffsets.end() - 1);
+    for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+      if (relevant[triIx] != 0) {
+        surfaceTriangles[cursor[triangles[triIx].surfaceIndex]++] = (uint32_t)triIx;
       }
     }
   }
 
-  for (int vertIx = 0; vertIx < vertices.size(); vertIx++) {
-    if (onlyBroken && brokenVerts.count(vertIx) == 0) {
+  // MikkTSpace runs once per surface, in parallel, and leaves a tangent on every triangle corner.
+  // Vertices of triangles with opposite UV winding were kept apart by polarityUv0 on import, so
+  // the corners of one vertex normally agree.
+  std::vector<Vec4f> cornerTangents(triangleCount * 3);
+  ThreadUtils::ParallelFor(surfaceCount, 1, [&](const size_t begin, const size_t end) {
+    for (size_t surfaceIx = begin; surfaceIx < end; surfaceIx++) {
+      TangentSpaceSurface surface{
+          triangles,
+          surfaceTriangles.data() + surfaceOffsets[surfaceIx],
+          (int)(surfaceOffsets[surfaceIx + 1] - surfaceOffsets[surfaceIx]),
+          streams,
+          cornerTangents};
+      if (surface.triangleCount == 0) {
+        continue;
+      }
+      SMikkTSpaceContext context{&tangentSpaceInterface, &surface};
+      genTangSpaceDefault(&context);
+    }
+  });
+
+  // Hand the corner tangents to their vertices. Where MikkTSpace gave the corners of one vertex
+  // different tangents, as it does across tangent space seams, the vertex is split.
+  std::vector<uint8_t> assigned(vertexCount, 0);
+  for (size_t triIx = 0; triIx < triangleCount; triIx++) {
+    if (relevant[triIx] == 0) {
       continue;
     }
-    RawVertex& vertex = vertices[vertIx];
-    if (glm::dot(vertex.normal, vertex.normal) < FLT_MIN) {
-      vertex.normal = vertex.position - averagePos;
-      if (glm::dot(vertex.normal, vertex.normal) < FLT_MIN) {
-        vertex.normal = Vec3f{0.0f, 1.0f, 0.0f};
+    for (int corner = 0; corner < 3; corner++) {
+      const int vertIx = triangles[triIx].verts[corner];
+      if (generate[vertIx] == 0) {
         continue;
       }
+      const Vec4f& tangent = cornerTangents[triIx * 3 + corner];
+      if (assigned[vertIx] == 0) {
+        streams.tangent[vertIx] = tangent;
+        assigned[vertIx] = 1;
+      } else if (memcmp(&streams.tangent[vertIx], &tangent, sizeof(Vec4f)) != 0) {
+        RawVertex vertex = GetVertex(vertIx);
+        vertex.tangent = tangent;
+        std::vector<RawBlendVertex> blends;
+        if (vertex.blendSurfaceIx >= 0) {
+          for (size_t channelIx = 0; channelIx < blendDeltas[vertex.blendSurfaceIx].size();
+               channelIx++) {
+            blends.push_back(GetBlendVertex(vertIx, (int)channelIx));
+          }
+        }
+        triangles[triIx].verts[corner] = AddVertex(vertex, blends);
+      }
     }
-    vertex.normal = glm::normalize(vertex.normal);
   }
-  return onlyBroken ? brokenVerts.size() : vertices.size();
+  return generateCount;
 }